@@ -0,0 +1,130 @@
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+#include "cat.h"
+#include "catreplayer.h"
+#include "histogram.h"
+#include "timer.h"
+#include "util.h"
+#include "throw.h"
+
+static void help()
+{
+	static const char helpstr[] =
+	    "\n"
+	    "Syntax: catbench [options] <recording>\n"
+	    "\n"
+	    "Options:\n"
+	    "  -h: show help and exit\n"
+	    "  -n <rounds>: play the recording this many times (default: 10)\n"
+	    "\n"
+	    "Recording (made by curseradio -t) is played back as fast as possible\n"
+	    "through the CAT response parser, in the chunks it was received in.\n"
+	    "Only Cat::read() is timed: reading a chunk from the port, splitting it\n"
+	    "into responses and decoding them.\n";
+
+	puts(helpstr);
+}
+
+int main(int argc, char *const argv[])
+{
+	try {
+		unsigned rounds(10);
+
+		int opt;
+		while((opt = getopt(argc, argv, ":hn:")) != -1) {
+			switch(opt) {
+				case '?':
+					xthrow("-%c: option not recognized", optopt);
+					break;
+
+				case ':':
+					xthrow("-%c: option requires argument", optopt);
+					break;
+
+				case 'h':
+					help();
+					return EXIT_SUCCESS;
+
+				case 'n':
+					rounds = atoi(optarg);
+					break;
+
+				default:
+					xthrow("Unknown value returned by getopt(): %d", opt);
+					break;
+			}
+		}
+
+		xassert(optind == argc - 1, "Recording not specified (see -h)");
+		xassert(rounds > 0, "Invalid number of rounds: %u", rounds);
+
+		Histogram readTime({250, 500, 1000, 2000, 4000, 8000, 16000, 32000});
+		std::vector<CatEvt> evts;
+		uint64_t total(0);
+		size_t responses(0);
+		size_t invalid(0);
+
+		for(unsigned round(0); round < rounds; ++round) {
+			Timer replayTimer;
+			Timer timeoutTimer;
+			Timer tuneTimer;
+			CatReplayer replayer(argv[optind], 0, &replayTimer);
+			Cat cat(replayer.getPortName(), replayer.getBaud(), &timeoutTimer, &tuneTimer, nullptr, nullptr, CAT_UPDATES_REPLAY);
+
+			const auto timedRead = [&]() {
+				const uint64_t start(util::monotonicNs());
+				cat.read(evts);
+				const uint64_t ns(util::monotonicNs() - start);
+
+				readTime.add(ns);
+				total += ns;
+				for(std::vector<CatEvt>::const_iterator i(evts.begin()); i != evts.end(); ++i) {
+					if(i->type == CatEvt::EVT_ERROR) {
+						++invalid;
+					}
+					else {
+						++responses;
+					}
+				}
+			};
+
+			/* One record is written at a time; pseudo-terminal passes it on
+			 * asynchronously, so Cat has to wait for it
+			 */
+			pollfd pfd = {cat.getFd(), POLLIN, 0};
+			bool more(true);
+			while(more) {
+				more = replayer.timerExpired();
+				if(poll(&pfd, 1, 1000) > 0) {
+					timedRead();
+				}
+			}
+
+			while(poll(&pfd, 1, 100) > 0) {
+				timedRead();
+			}
+		}
+
+		xassert(readTime.getCount(), "Nothing was read");
+
+		std::vector<std::string> report;
+		report.push_back(util::format("%u rounds, %lu reads, %zu responses, %zu invalid", rounds, (unsigned long) readTime.getCount(), responses, invalid));
+		report.push_back(util::format("  Total: %.2f ms, %.0f ns per response", total / 1e6, responses ? (double) total / responses : 0.0));
+		readTime.report("Cat::read()", "ns", report);
+
+		for(std::vector<std::string>::const_iterator i(report.begin()); i != report.end(); ++i) {
+			printf("%s\n", i->c_str());
+		}
+	}
+	catch(const std::runtime_error &e) {
+		fprintf(stderr, "Fatal error: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
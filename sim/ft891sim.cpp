@@ -0,0 +1,137 @@
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <csignal>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include "simulator.h"
+#include "reactor.h"
+#include "fd.h"
+#include "throw.h"
+
+static void help()
+{
+	static const char helpstr[] =
+	    "\n"
+	    "Syntax: ft891sim [options]\n"
+	    "\n"
+	    "Options:\n"
+	    "  -h: show help and exit\n"
+	    "  -p <path>: create a symlink to the pseudo-terminal (removed on exit)\n"
+	    "  -b <rate>: baudrate to pace responses at (0: no pacing, default: 38400)\n"
+	    "  -l <us>: latency before each response (default: 0)\n"
+	    "  -d <rate>: probability of dropping each byte sent (default: 0)\n"
+	    "  -t: start in TX\n"
+	    "\n"
+	    "Pseudo-terminal name is printed on startup; pass it to curseradio\n"
+	    "with -c. SIGUSR1 toggles TX and RX. Statistics are printed on exit\n"
+	    "(SIGINT or SIGTERM).\n";
+
+	puts(helpstr);
+}
+
+int main(int argc, char *const argv[])
+{
+	try {
+		Simulator::Config config;
+		std::string link;
+
+		int opt;
+		while((opt = getopt(argc, argv, ":hp:b:l:d:t")) != -1) {
+			switch(opt) {
+				case '?':
+					xthrow("-%c: option not recognized", optopt);
+					break;
+
+				case ':':
+					xthrow("-%c: option requires argument", optopt);
+					break;
+
+				case 'h':
+					help();
+					return EXIT_SUCCESS;
+
+				case 'p':
+					link = optarg;
+					break;
+
+				case 'b':
+					config.baud = atoi(optarg);
+					break;
+
+				case 'l':
+					config.latencyUs = atoi(optarg);
+					break;
+
+				case 'd':
+					config.dropRate = atof(optarg);
+					break;
+
+				case 't':
+					config.tx = true;
+					break;
+
+				default:
+					xthrow("Unknown value returned by getopt(): %d", opt);
+					break;
+			}
+		}
+
+		xassert(optind == argc, "Excessive arguments");
+
+		sigset_t mask;
+		sigemptyset(&mask);
+		sigaddset(&mask, SIGINT);
+		sigaddset(&mask, SIGTERM);
+		sigaddset(&mask, SIGUSR1);
+		xassert(sigprocmask(SIG_BLOCK, &mask, nullptr) == 0, "Could not block signals: %m");
+		const Fd sigfd(signalfd(-1, &mask, SFD_CLOEXEC));
+		xassert(sigfd != -1, "Could not create signalfd: %m");
+
+		srand48(time(nullptr));
+
+		Simulator sim(config);
+		if(!link.empty()) {
+			unlink(link.c_str());
+			xassert(symlink(sim.getPortName().c_str(), link.c_str()) == 0, "Could not create symlink %s: %m", link.c_str());
+		}
+
+		printf("%s\n", sim.getPortName().c_str());
+		fflush(stdout);
+
+		bool quit(false);
+		Reactor reactor;
+		reactor.add(sim.getFd(), [&sim]() { sim.read(); });
+		reactor.add(sim.getTimerFd(), [&sim]() { sim.timerExpired(); });
+		reactor.add(sigfd, [&sim, &sigfd, &quit]() {
+			signalfd_siginfo si;
+			xassert(read(sigfd, &si, sizeof(si)) == sizeof(si), "Could not read from signalfd: %m");
+			if(si.ssi_signo == SIGUSR1) {
+				sim.toggleTx();
+			}
+			else {
+				quit = true;
+			}
+		});
+
+		while(!quit) {
+			reactor.wait(-1);
+		}
+
+		if(!link.empty()) {
+			unlink(link.c_str());
+		}
+
+		const std::vector<std::string> report(sim.getReport());
+		for(std::vector<std::string>::const_iterator i(report.begin()); i != report.end(); ++i) {
+			printf("%s\n", i->c_str());
+		}
+	}
+	catch(const std::runtime_error &e) {
+		fprintf(stderr, "Fatal error: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
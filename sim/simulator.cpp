@@ -0,0 +1,304 @@
+#include <cerrno>
+#include <cmath>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "simulator.h"
+#include "throw.h"
+#include "util.h"
+
+/* Frequencies set by BS; codes as in bandMap in cat.cpp */
+static const std::map<unsigned, uint32_t> bandFreqs = {
+    {0x00, 1810000},
+    {0x01, 3500000},
+    {0x03, 7000000},
+    {0x04, 10100000},
+    {0x05, 14000000},
+    {0x06, 18068000},
+    {0x07, 21000000},
+    {0x08, 24890000},
+    {0x09, 28000000},
+    {0x10, 50000000},
+    {0x11, 5000000},
+    {0x12, 1000000},
+};
+
+/* Valid mode codes; as in modeMap in cat.cpp */
+static bool isModeValid(unsigned mode)
+{
+	return mode >= 0x1 && mode <= 0xD && mode != 0xA;
+}
+
+static bool isFreqValid(uint32_t freq)
+{
+	return freq >= 30000 && freq <= 56000000;
+}
+
+Simulator::Simulator(const Config &config)
+    : config(config),
+      byteNs(config.baud ? 10 * 1000000000ULL / config.baud : 0),
+      master(posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK)),
+      tx(config.tx),
+      startTime(util::monotonicNs())
+{
+	xassert(master != -1, "Could not open pseudo-terminal: %m");
+	xassert(grantpt(master) == 0 && unlockpt(master) == 0, "Could not unlock pseudo-terminal: %m");
+
+	slave.reset(open(getPortName().c_str(), O_RDWR | O_NOCTTY));
+	xassert(slave != -1, "Could not open pseudo-terminal slave: %m");
+
+	/* Raw until the client configures it; with echo, responses would come
+	 * back to us as commands
+	 */
+	termios t;
+	xassert(tcgetattr(slave, &t) != -1, "Could not get pseudo-terminal attributes: %m");
+	cfmakeraw(&t);
+	xassert(tcsetattr(slave, TCSANOW, &t) != -1, "Could not set pseudo-terminal attributes: %m");
+}
+
+std::string Simulator::getPortName() const
+{
+	const char *name(ptsname(master));
+	xassert(name, "Could not get pseudo-terminal name: %m");
+	return name;
+}
+
+int Simulator::getFd() const
+{
+	return master;
+}
+
+void Simulator::read()
+{
+	char buf[1024];
+	ssize_t rs;
+	do {
+		rs = ::read(master, buf, sizeof(buf));
+	} while(rs == -1 && errno == EINTR);
+
+	if(rs == -1 && errno == EAGAIN) {
+		return;
+	}
+
+	xassert(rs > 0, "Could not read from pseudo-terminal: %zd, %m", rs);
+	bytesReceived += rs;
+	recvq.append(buf, rs);
+
+	std::string::size_type end;
+	while((end = recvq.find(';')) != std::string::npos) {
+		const std::string cmd(recvq.substr(0, end));
+		recvq.erase(0, end + 1);
+		command(cmd);
+	}
+}
+
+int Simulator::getTimerFd() const
+{
+	return timer.getFd();
+}
+
+void Simulator::timerExpired()
+{
+	if(timer.read()) {
+		pump();
+	}
+}
+
+void Simulator::toggleTx()
+{
+	tx = !tx;
+}
+
+void Simulator::command(const std::string &cmd)
+{
+	const std::string code(cmd.substr(0, 2));
+	const std::string arg(cmd.size() > 2 ? cmd.substr(2) : "");
+
+	/* Values are parsed loosely; invalid ones end up rejected by range checks */
+	const unsigned long value(strtoul(arg.c_str(), nullptr, 10));
+
+	if(code == "RM" && arg.size() == 1) {
+		commands[cmd]++;
+		respond("RM%c%03u", arg[0], getMeter(arg[0] - '0'));
+	}
+	else if(code == "FA" && arg.empty()) {
+		commands[cmd]++;
+		respond("FA%09u", freqA);
+	}
+	else if(code == "FA" && arg.size() == 9 && isFreqValid(value)) {
+		commands["FA (set)"]++;
+		freqA = value;
+		if(autoInfo) {
+			respond("FA%09u", freqA);
+		}
+	}
+	else if(code == "MD" && arg == "0") {
+		commands[cmd]++;
+		respond("MD0%X", mode);
+	}
+	else if(code == "MD" && arg.size() == 2 && arg[0] == '0' && isModeValid(strtoul(arg.c_str() + 1, nullptr, 16))) {
+		commands["MD0 (set)"]++;
+		mode = strtoul(arg.c_str() + 1, nullptr, 16);
+		if(autoInfo) {
+			respond("MD0%X", mode);
+		}
+	}
+	else if(code == "BS" && arg.size() == 2 && bandFreqs.find(strtoul(arg.c_str(), nullptr, 16)) != bandFreqs.end()) {
+		commands["BS"]++;
+		freqA = bandFreqs.at(strtoul(arg.c_str(), nullptr, 16));
+		if(autoInfo) {
+			respond("FA%09u", freqA);
+		}
+	}
+	else if(code == "SV" && arg.empty()) {
+		commands["SV"]++;
+		std::swap(freqA, freqB);
+		if(autoInfo) {
+			respond("FA%09u", freqA);
+		}
+	}
+	else if(code == "TX" && (arg == "0" || arg == "1")) {
+		commands["TX (set)"]++;
+		tx = (arg == "1");
+	}
+	else if(code == "ZI" && arg.empty()) {
+		/* Nothing to zero in on */
+		commands["ZI"]++;
+	}
+	else if(code == "EX" && arg == "0520") {
+		commands[cmd]++;
+		respond("EX0520%u", fanMode);
+	}
+	else if(code == "EX" && arg.size() == 5 && arg.compare(0, 4, "0520") == 0 && (arg[4] == '0' || arg[4] == '1')) {
+		commands["EX0520 (set)"]++;
+		fanMode = arg[4] - '0';
+	}
+	else if(code == "AI" && arg.empty()) {
+		commands[cmd]++;
+		respond("AI%u", autoInfo ? 1 : 0);
+	}
+	else if(code == "AI" && (arg == "0" || arg == "1")) {
+		commands["AI (set)"]++;
+		autoInfo = (arg == "1");
+	}
+	else if(code == "ID" && arg.empty()) {
+		commands[cmd]++;
+		respond("ID0650");
+	}
+	else {
+		/* That's what the radio does with anything it doesn't understand */
+		commands["invalid"]++;
+		respond("?");
+	}
+}
+
+void Simulator::respond(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+
+	char *p;
+	xassert(vasprintf(&p, fmt, ap) != -1, "Memory allocation error in vasprintf");
+	va_end(ap);
+
+	Chunk c;
+	c.notBefore = util::monotonicNs() + config.latencyUs * 1000ULL;
+	c.data      = p;
+	c.data += ';';
+	c.pos = 0;
+	free(p);
+
+	sendq.push_back(c);
+	pump();
+}
+
+void Simulator::pump()
+{
+	const uint64_t now(util::monotonicNs());
+	while(!sendq.empty()) {
+		Chunk &c(sendq.front());
+		const uint64_t start(std::max(c.notBefore, lineFree));
+		if(start > now) {
+			timer.startAt(start);
+			return;
+		}
+
+		/* Bytes whose transmission has started by now */
+		size_t count(c.data.size() - c.pos);
+		if(byteNs && (now - start) / byteNs + 1 < count) {
+			count = (now - start) / byteNs + 1;
+		}
+
+		for(size_t i(0); i < count; ++i) {
+			if(drand48() < config.dropRate) {
+				bytesDropped++;
+				continue;
+			}
+
+			/* Client not reading or not connected; it's lost like on a wire */
+			if(write(master, &c.data[c.pos + i], 1) == 1) {
+				bytesSent++;
+			}
+		}
+
+		c.pos += count;
+		lineFree = start + count * byteNs;
+		if(c.pos < c.data.size()) {
+			timer.startAt(lineFree);
+			return;
+		}
+
+		sendq.pop_front();
+	}
+}
+
+uint8_t Simulator::getMeter(unsigned meter) const
+{
+	/* Slowly changing values, so the status bar shows some life */
+	const double t((util::monotonicNs() - startTime) / 1e9);
+	const double wave((sin(t) + 1) / 2);
+
+	switch(meter) {
+		case 1: /* SIG */
+			return tx ? 0 : 60 + wave * 120;
+
+		case 3: /* COMP */
+			return tx ? 40 + wave * 60 : 0;
+
+		case 4: /* ALC */
+			return tx ? 20 + wave * 80 : 0;
+
+		case 5: /* PWR */
+			return tx ? 150 + wave * 50 : 0;
+
+		case 6: /* SWR */
+			return tx ? 30 : 0;
+
+		case 7: /* IDD */
+			return tx ? 100 + wave * 40 : 0;
+
+		default:
+			return 0;
+	}
+}
+
+std::vector<std::string> Simulator::getReport() const
+{
+	const double elapsed((util::monotonicNs() - startTime) / 1e9);
+
+	std::vector<std::string> rs;
+	rs.push_back(util::format("Simulated for %.1f s: %lu bytes received, %lu bytes sent, %lu bytes dropped",
+	    elapsed,
+	    (unsigned long) bytesReceived,
+	    (unsigned long) bytesSent,
+	    (unsigned long) bytesDropped));
+
+	for(std::map<std::string, uint64_t>::const_iterator i(commands.begin()); i != commands.end(); ++i) {
+		rs.push_back(util::format("  %s: %lu (%.1f/s)", i->first.c_str(), (unsigned long) i->second, i->second / elapsed));
+	}
+
+	return rs;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstdint>
+#include "fd.h"
+#include "timer.h"
+
+/* FT-891 CAT simulator on a pseudo-terminal. Answers commands used by
+ * CurseRadio (RM, FA, MD0, BS, SV, ZI, EX, AI, ID) and keeps the state
+ * they change. Responses are delayed by a fixed latency, paced at the
+ * given baudrate, and bytes may be dropped to simulate a bad link.
+ */
+class Simulator {
+public:
+	struct Config {
+		unsigned baud{38400};   /* 0 = no pacing */
+		uint32_t latencyUs{0};  /* Before sending a response */
+		double dropRate{0};     /* Probability of dropping a byte sent */
+		bool tx{false};
+	};
+
+	Simulator(const Config &config);
+
+	std::string getPortName() const;
+
+	int getFd() const;
+	void read();
+
+	int getTimerFd() const;
+	void timerExpired();
+
+	void toggleTx();
+
+	std::vector<std::string> getReport() const;
+
+private:
+	struct Chunk {
+		uint64_t notBefore;
+		std::string data;
+		size_t pos;
+	};
+
+	const Config config;
+	const uint64_t byteNs;
+	Fd master;
+	Fd slave; /* Kept open, so the master doesn't hang up between clients */
+	Timer timer;
+	std::string recvq;
+	std::deque<Chunk> sendq;
+	uint64_t lineFree{0};
+
+	uint32_t freqA{14025000};
+	uint32_t freqB{7025000};
+	uint8_t mode{0x3};
+	uint8_t fanMode{0};
+	bool autoInfo{false};
+	bool tx;
+
+	const uint64_t startTime;
+	std::map<std::string, uint64_t> commands;
+	uint64_t bytesReceived{0};
+	uint64_t bytesSent{0};
+	uint64_t bytesDropped{0};
+
+	void command(const std::string &cmd);
+	void respond(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+	void pump();
+	uint8_t getMeter(unsigned meter) const;
+};
@@ -0,0 +1,88 @@
+#include "callsuggester.h"
+
+CallSuggester::CallSuggester(Logger *logger, const Scp *scp)
+    : logger(logger), scp(scp)
+{
+}
+
+void CallSuggester::update(const std::string &newPart)
+{
+	const bool extends(!part.empty() && newPart.size() > part.size() && newPart.compare(0, part.size(), part) == 0);
+	part = newPart;
+
+	if(part.empty()) {
+		worked.clear();
+		known.clear();
+		knownWorked = 0;
+		return;
+	}
+
+	if(logger) {
+		if(!extends) {
+			logger->getCalls(logCalls);
+			worked.resize(logCalls.size());
+			for(uint32_t i(0); i < worked.size(); ++i) {
+				worked[i] = i;
+			}
+		}
+
+		std::vector<uint32_t>::iterator out(worked.begin());
+		for(std::vector<uint32_t>::const_iterator i(worked.begin()); i != worked.end(); ++i) {
+			if(logCalls[*i].find(part) != std::string::npos) {
+				*out++ = *i;
+			}
+		}
+		worked.erase(out, worked.end());
+	}
+
+	if(scp) {
+		if(extends) {
+			scp->narrow(part, known);
+		}
+		else {
+			scp->find(part, known);
+		}
+	}
+
+	/* Worked callsign containing the partial, if it's known, is among known
+	 * suggestions too; both are sorted, so they're merged
+	 */
+	knownWorked = 0;
+	std::vector<uint32_t>::const_iterator k(known.begin());
+	for(std::vector<uint32_t>::const_iterator i(worked.begin()); i != worked.end() && k != known.end(); ++i) {
+		while(k != known.end() && scp->getCall(*k) < logCalls[*i]) {
+			++k;
+		}
+
+		if(k != known.end() && scp->getCall(*k) == logCalls[*i]) {
+			++knownWorked;
+		}
+	}
+}
+
+void CallSuggester::get(size_t max, std::vector<std::string> &workedCalls, std::vector<std::string> &knownCalls) const
+{
+	workedCalls.clear();
+	knownCalls.clear();
+
+	for(std::vector<uint32_t>::const_iterator i(worked.begin()); i != worked.end() && workedCalls.size() < max; ++i) {
+		workedCalls.push_back(logCalls[*i]);
+	}
+
+	std::vector<uint32_t>::const_iterator w(worked.begin());
+	for(std::vector<uint32_t>::const_iterator i(known.begin()); i != known.end() && workedCalls.size() + knownCalls.size() < max; ++i) {
+		const std::string_view call(scp->getCall(*i));
+		while(w != worked.end() && logCalls[*w] < call) {
+			++w;
+		}
+
+		if(w == worked.end() || logCalls[*w] != call) {
+			knownCalls.push_back(std::string(call));
+		}
+	}
+}
+
+size_t CallSuggester::getCount() const
+{
+	return worked.size() + known.size() - knownWorked;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "logger.h"
+#include "scp.h"
+
+/* Callsigns containing what's being typed, from the log and from known
+ * callsigns, updated on every keystroke. When a character is appended,
+ * previous suggestions are narrowed down instead of being searched for
+ * again, as nothing else can contain the longer partial; the log is read
+ * again only when starting over.
+ */
+class CallSuggester {
+public:
+	/* Either may be null */
+	CallSuggester(Logger *logger, const Scp *scp);
+
+	/* Uppercase; empty partial clears suggestions */
+	void update(const std::string &newPart);
+
+	/* Worked callsigns first, then known callsigns not worked yet, max in
+	 * total, both sorted
+	 */
+	void get(size_t max, std::vector<std::string> &workedCalls, std::vector<std::string> &knownCalls) const;
+
+	/* All suggestions, including those not returned by get() */
+	size_t getCount() const;
+
+private:
+	Logger *logger;
+	const Scp *scp;
+
+	std::string part;                  /* Partial the suggestions are for */
+	std::vector<std::string> logCalls; /* Callsigns in the log, when starting over */
+	std::vector<uint32_t> worked;      /* Indexes in logCalls */
+	std::vector<uint32_t> known;       /* Indexes in scp */
+	size_t knownWorked{0};             /* Known callsigns that are also worked */
+};
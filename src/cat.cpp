@@ -2,11 +2,20 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <cstdarg>
+#include <cstring>
 #include <map>
+#include <array>
 #include <algorithm>
 #include "throw.h"
+#include "util.h"
 #include "cat.h"
 
+/* A request not answered in time is sent again, with the timeout doubled
+ * every time; after the last retry it's given up
+ */
+static const uint64_t RESPONSE_TIMEOUT_NS = 200000000ULL;
+static const unsigned MAX_RETRIES         = 2;
+
 static const std::map<meters::Meter, uint8_t> meterMap = {
     {meters::METER_SIG, 1},
     {meters::METER_COMP, 3},
@@ -46,6 +55,60 @@ static const std::map<Mode, uint8_t> modeMap = {
     {MODE_AM_N, 0xD},
 };
 
+/* Reverse lookup tables, indexed by the code sent by the radio */
+template<typename T, size_t N>
+static std::array<std::optional<T>, N> makeDecodeTable(const std::map<T, uint8_t> &map)
+{
+	std::array<std::optional<T>, N> table;
+	for(typename std::map<T, uint8_t>::const_iterator i(map.begin()); i != map.end(); ++i) {
+		xassert(i->second < N, "Code %u doesn't fit in decode table", i->second);
+		table[i->second] = i->first;
+	}
+
+	return table;
+}
+
+static const std::array<std::optional<meters::Meter>, 10> meterDecodeTable(makeDecodeTable<meters::Meter, 10>(meterMap));
+static const std::array<std::optional<Mode>, 16> modeDecodeTable(makeDecodeTable<Mode, 16>(modeMap));
+
+/* Returns -1 if character is not a digit in given base (10 or 16) */
+static int decodeDigit(char c, int base)
+{
+	if(c >= '0' && c <= '9') {
+		return c - '0';
+	}
+
+	if(base == 16 && c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	if(base == 16 && c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+
+	return -1;
+}
+
+/* Returns -1 if s is empty or contains anything but decimal digits */
+static long decodeNumber(std::string_view s)
+{
+	if(s.empty()) {
+		return -1;
+	}
+
+	long value(0);
+	for(std::string_view::const_iterator i(s.begin()); i != s.end(); ++i) {
+		const int digit(decodeDigit(*i, 10));
+		if(digit == -1) {
+			return -1;
+		}
+
+		value = value * 10 + digit;
+	}
+
+	return value;
+}
+
 static speed_t translateBaud(unsigned baud)
 {
 	static std::map<unsigned, speed_t> baudMap = {
@@ -60,11 +123,16 @@ static speed_t translateBaud(unsigned baud)
 	return i->second;
 }
 
-Cat::Cat(const std::string &port, unsigned baud, Timer *timeoutTimer)
-    : fd(open(port.c_str(), O_RDWR | O_NOCTTY)), timeoutTimer(timeoutTimer)
+Cat::Cat(const std::string &port, unsigned baud, Timer *timeoutTimer, Timer *tuneTimer, CatStats *stats, CatRecorder *recorder, CatUpdates updates)
+    : fd(open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK)), baud(baud), timeoutTimer(timeoutTimer), tuneTimer(tuneTimer), stats(stats), recorder(recorder), updates(updates)
 {
 	xassert(fd != -1, "Could not open device %s: %m", port.c_str());
 	xassert(timeoutTimer, "timeoutTimer is nullptr");
+	xassert(tuneTimer, "tuneTimer is nullptr");
+
+	if(stats) {
+		stats->started(baud);
+	}
 
 	termios t;
 	xassert(tcgetattr(fd, &t) != -1, "Could not get port attributes: %m");
@@ -82,10 +150,42 @@ Cat::Cat(const std::string &port, unsigned baud, Timer *timeoutTimer)
 	xassert(cfsetispeed(&t, speed) != -1, "Could not set input speed: %m");
 	xassert(cfsetospeed(&t, speed) != -1, "Could not set output speed: %m");
 	xassert(tcsetattr(fd, TCSAFLUSH, &t) != -1, "Could not set port attributes: %m");
+
+	if(updates == CAT_UPDATES_AUTO_INFO) {
+		/* Initial values have to be read, later they're sent by the radio */
+		beginBatch();
+		send("AI1");
+		getFreq();
+		getMode();
+		endBatch();
+	}
 }
 
 Cat::~Cat()
 {
+	/* Whatever is still queued is written synchronously. Errors are
+	 * ignored, we're going down anyway.
+	 */
+	if(updates == CAT_UPDATES_AUTO_INFO) {
+		sendq += "AI0;";
+	}
+
+	const int flags(fcntl(fd, F_GETFL));
+	if(flags != -1 && fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) != -1) {
+		while(sendPos < sendq.size()) {
+			const ssize_t rs(write(fd, sendq.data() + sendPos, sendq.size() - sendPos));
+			if(rs == -1 && errno == EINTR) {
+				continue;
+			}
+
+			if(rs <= 0) {
+				break;
+			}
+
+			sendPos += rs;
+		}
+	}
+
 	tcdrain(fd);
 }
 
@@ -94,118 +194,267 @@ int Cat::getFd() const
 	return fd;
 }
 
-std::vector<std::string> Cat::tokenizeRecvq()
+void Cat::read(std::vector<CatEvt> &evts)
 {
-	std::vector<std::string> v;
-	std::string::iterator i;
-	while((i = std::find(recvq.begin(), recvq.end(), ';')) != recvq.end()) {
-		const std::string s(recvq.begin(), i);
-		v.push_back(s);
-		recvq.erase(recvq.begin(), i + 1);
+	evts.clear();
+
+	ssize_t rs;
+	do {
+		rs = ::read(fd, recvBuf + recvLen, sizeof(recvBuf) - recvLen);
+	} while(rs == -1 && errno == EINTR);
+
+	if(rs == -1 && errno == EAGAIN) {
+		return;
+	}
+
+	xassert(rs != -1, "CAT read error: %m");
+	xassert(rs, "CAT EOF (radio disconnected? RF interference?)");
+	if(recorder) {
+		recorder->record(CatRecorder::DIR_RX, recvBuf + recvLen, rs);
 	}
 
-	return v;
+	recvLen += rs;
+	if(stats) {
+		stats->received(rs);
+	}
+
+	/* Responses are parsed in place, without copying */
+	const std::string_view data(recvBuf, recvLen);
+	size_t start(0);
+	size_t end;
+	while((end = data.find(';', start)) != std::string_view::npos) {
+		const std::string_view resp(data.substr(start, end - start));
+		if(!parseResponse(resp, evts)) {
+			/* Resynchronize at the next terminator */
+			std::string printable(resp);
+			std::replace_if(printable.begin(), printable.end(), [](char c) { return !isprint((unsigned char) c); }, '?');
+
+			CatEvt evt(CatEvt::EVT_ERROR);
+			evt.error = util::format("Ignored invalid response: %s", printable.c_str());
+			evts.push_back(evt);
+
+			if(stats) {
+				stats->invalid();
+			}
+		}
+
+		start = end + 1;
+	}
+
+	/* Only the incomplete response, if any, is left for the next read */
+	recvLen -= start;
+	memmove(recvBuf, recvBuf + start, recvLen);
+
+	/* No terminator in the whole buffer, it's garbage; start over */
+	if(recvLen == sizeof(recvBuf)) {
+		CatEvt evt(CatEvt::EVT_ERROR);
+		evt.error = util::format("Discarded %zu bytes of garbage", recvLen);
+		evts.push_back(evt);
+
+		if(stats) {
+			stats->invalid();
+		}
+		recvLen = 0;
+	}
 }
 
-std::vector<CatEvt> Cat::read()
+bool Cat::parseResponse(std::string_view resp, std::vector<CatEvt> &evts)
 {
-	char buf[1024];
-	const ssize_t rs(saferead(fd, buf, sizeof(buf)));
-	xassert(rs, "CAT EOF (radio disconnected? RF interference?)");
-	std::copy(buf, buf + rs, std::back_inserter(recvq));
-	std::vector<std::string> catResponses(tokenizeRecvq());
+	if(resp.size() <= 2) {
+		return false;
+	}
 
-	std::vector<CatEvt> evts;
+	const std::string_view code(resp.substr(0, 2));
+	if(code == "RM") {
+		if(resp.size() != 6) {
+			return false;
+		}
 
-	for(std::vector<std::string>::const_iterator i(catResponses.begin()); i != catResponses.end(); ++i) {
-		xassert(i->size() > 2, "CAT response %s too short", i->c_str());
-		const std::string code(i->substr(0, 2));
-		if(code == "RM") {
-			xassert(i->size() == 6, "CAT RM response %s too short", i->c_str());
+		const int meter(decodeDigit(resp[2], 10));
+		const long value(decodeNumber(resp.substr(3)));
+		if(meter == -1 || !meterDecodeTable[meter] || value < 0 || value > 255) {
+			return false;
+		}
 
-			const uint8_t meter((*i)[2] - '0');
-			const std::map<meters::Meter, uint8_t>::const_iterator mi(std::find_if(meterMap.begin(), meterMap.end(), [meter](const auto &entry) { return entry.second == meter; }));
-			xassert(mi != meterMap.end(), "Could not find meter in meter map, CAT response is %s", i->c_str());
+		CatEvt evt(CatEvt::EVT_METER);
+		evt.meter = std::pair<meters::Meter, uint8_t>(meterDecodeTable[meter].value(), value);
+		if(gotResponse(resp, evt.type)) {
+			evts.push_back(evt);
+		}
+	}
+	else if(code == "FA") {
+		if(resp.size() != 11) {
+			return false;
+		}
 
-			const long value(strtol(i->c_str() + 3, nullptr, 10));
-			xassert(value >= 0 && value <= 255, "Meter value out of range (%ld), CAT response is %s", value, i->c_str());
+		const long value(decodeNumber(resp.substr(2)));
+		if(value < 30000 || value > 56000000) {
+			return false;
+		}
 
-			CatEvt evt(CatEvt::EVT_METER);
-			evt.meter = std::pair<meters::Meter, uint8_t>(mi->first, value);
+		CatEvt evt(CatEvt::EVT_FREQ);
+		evt.freq = value;
+		if(gotResponse(resp, evt.type)) {
 			evts.push_back(evt);
 		}
-		else if(code == "FA") {
-			xassert(i->size() == 11, "CAT FA response %s too short", i->c_str());
-			const std::string freq(i->substr(2, 9));
-			const long value(strtol(freq.c_str(), nullptr, 10));
-			xassert(value >= 30000 && value <= 56000000, "Invalid CAT FA response: %s", i->c_str());
-
-			CatEvt evt(CatEvt::EVT_FREQ);
-			evt.freq = value;
-			evts.push_back(evt);
+	}
+	else if(code == "MD") {
+		if(resp.size() != 4 || resp[2] != '0') {
+			return false;
 		}
-		else if(code == "MD") {
-			xassert(i->size() == 4, "CAT MD response %s too short", i->c_str());
-			xassert((*i)[2] == '0', "CAT MD response %s invalid", i->c_str());
 
-			const long mode(strtol(i->c_str() + 3, nullptr, 16));
-			const std::map<Mode, uint8_t>::const_iterator mi(std::find_if(modeMap.begin(), modeMap.end(), [mode](const auto &entry) { return entry.second == mode; }));
-			xassert(mi != modeMap.end(), "Could not find mode in mode map, CAT response is %s", i->c_str());
+		const int mode(decodeDigit(resp[3], 16));
+		if(mode == -1 || !modeDecodeTable[mode]) {
+			return false;
+		}
 
-			CatEvt evt(CatEvt::EVT_MODE);
-			evt.mode = mi->first;
+		CatEvt evt(CatEvt::EVT_MODE);
+		evt.mode = modeDecodeTable[mode];
+		if(gotResponse(resp, evt.type)) {
 			evts.push_back(evt);
 		}
-		else {
-			xthrow("Unsupported CAT response: %s", i->c_str());
-		}
 	}
-
-	/* Moved here to be less error-prone */
-	for(std::vector<CatEvt>::const_iterator i(evts.begin()); i != evts.end(); ++i) {
-		gotEvent(i->type);
+	else if(updates == CAT_UPDATES_POLL) {
+		/* In Auto-Information mode (and in its recordings) radio sends
+		 * other information too, we don't need it
+		 */
+		return false;
 	}
 
-	return evts;
+	return true;
+}
+
+void Cat::beginBatch()
+{
+	xassert(!batching, "Batch already started");
+	batching = true;
+}
+
+void Cat::endBatch()
+{
+	xassert(batching, "Batch not started");
+	batching = false;
+	flush();
+}
+
+void Cat::writeReady()
+{
+	writeQueue();
+}
+
+bool Cat::isWritePending() const
+{
+	return sendPos < sendq.size();
+}
+
+bool Cat::isFirstTryDone() const
+{
+	return std::find_if(requests.begin(), requests.end(), [](const Request &req) { return !req.retries; }) == requests.end();
+}
+
+CatUpdates Cat::getUpdates() const
+{
+	return updates;
 }
 
 void Cat::getMeter(meters::Meter meter)
 {
 	const std::map<meters::Meter, uint8_t>::const_iterator i(meterMap.find(meter));
 	xassert(i != meterMap.end(), "Could not find meter %d", meter);
-	send("RM%u", i->second);
-	expectEvent(CatEvt::EVT_METER);
+	request(CatEvt::EVT_METER, util::format("RM%u", i->second));
 }
 
 void Cat::getFreq()
 {
-	send("FA");
-	expectEvent(CatEvt::EVT_FREQ);
+	request(CatEvt::EVT_FREQ, "FA");
 }
 
-void Cat::setFreq(uint32_t freq)
+void Cat::getMode()
 {
-	send("FA%09u", freq);
+	request(CatEvt::EVT_MODE, "MD0");
 }
 
-void Cat::getMode()
+void Cat::setFreq(uint32_t freq)
 {
-	send("MD0");
-	expectEvent(CatEvt::EVT_MODE);
+	pendingFreq = freq;
+	markStale(CatEvt::EVT_FREQ);
+
+	if(!tuneHoldoff) {
+		flushTuning();
+	}
 }
 
 void Cat::setBand(Band band)
 {
-	const std::map<Band, uint8_t>::const_iterator i(bandMap.find(band));
-	xassert(i != bandMap.end(), "Could not find band %d", band);
-	send("BS%02x", i->second);
+	xassert(bandMap.find(band) != bandMap.end(), "Could not find band %d", band);
+
+	/* Band change overrides frequency and mode set before it */
+	pendingBand = band;
+	pendingFreq.reset();
+	pendingMode.reset();
+	markStale(CatEvt::EVT_FREQ);
+	markStale(CatEvt::EVT_MODE);
+
+	if(!tuneHoldoff) {
+		flushTuning();
+	}
 }
 
 void Cat::setMode(Mode mode)
 {
-	const std::map<Mode, uint8_t>::const_iterator i(modeMap.find(mode));
-	xassert(i != modeMap.end(), "Could not find mode %d", mode);
-	send("MD0%X", i->second);
+	xassert(modeMap.find(mode) != modeMap.end(), "Could not find mode %d", mode);
+
+	pendingMode = mode;
+	markStale(CatEvt::EVT_MODE);
+
+	if(!tuneHoldoff) {
+		flushTuning();
+	}
+}
+
+void Cat::tuneTimerExpired()
+{
+	tuneHoldoff = false;
+	flushTuning();
+}
+
+void Cat::flushTuning()
+{
+	if(!pendingFreq && !pendingBand && !pendingMode) {
+		return;
+	}
+
+	const bool ownBatch(!batching);
+	if(ownBatch) {
+		beginBatch();
+	}
+
+	/* Band first, as it changes both frequency and mode */
+	const size_t queued(sendq.size());
+	if(pendingBand) {
+		send("BS%02x", bandMap.at(pendingBand.value()));
+	}
+
+	if(pendingMode) {
+		send("MD0%X", modeMap.at(pendingMode.value()));
+	}
+
+	if(pendingFreq) {
+		send("FA%09u", pendingFreq.value());
+	}
+
+	const size_t bytes(sendq.size() - queued);
+	pendingFreq.reset();
+	pendingBand.reset();
+	pendingMode.reset();
+
+	if(ownBatch) {
+		endBatch();
+	}
+
+	/* Next tuning command not earlier than this one is transmitted */
+	tuneTimer->startAt(util::monotonicNs() + getTransmitNs(bytes));
+	tuneHoldoff = true;
 }
 
 void Cat::setFanMode(FanMode fanMode)
@@ -216,33 +465,170 @@ void Cat::setFanMode(FanMode fanMode)
 
 void Cat::swapVfo()
 {
+	/* Pending tuning applies to the VFO selected before */
+	flushTuning();
 	send("SV");
 }
 
 void Cat::zin()
 {
+	flushTuning();
 	send("ZI");
 }
 
-void Cat::expectEvent(CatEvt::EventType evt)
+void Cat::setTx(bool tx)
+{
+	/* Pending tuning should be done before transmitting */
+	flushTuning();
+	send("TX%d", tx ? 1 : 0);
+}
+
+void Cat::timeoutTimerExpired(std::vector<CatEvt> &evts)
 {
-	if(expectedEvents.empty()) {
-		timeoutTimer->start();
+	evts.clear();
+
+	const uint64_t now(util::monotonicNs());
+	const bool ownBatch(!batching);
+	if(ownBatch) {
+		beginBatch();
 	}
 
-	expectedEvents.push_back(evt);
+	for(std::vector<Request>::iterator i(requests.begin()); i != requests.end();) {
+		if(i->deadline > now) {
+			++i;
+		}
+		else if(i->retries < MAX_RETRIES) {
+			i->retries++;
+			i->deadline = now + getTransmitNs(sendq.size() - sendPos) + (RESPONSE_TIMEOUT_NS << i->retries);
+			i->stale    = isTuningPending(i->type);
+			i->sendEnd  = sendq.size() + i->cmd.size() + 1;
+			i->sent     = 0;
+			send("%s", i->cmd.c_str());
+			++i;
+
+			if(stats) {
+				stats->retry();
+			}
+		}
+		else {
+			CatEvt evt(CatEvt::EVT_ERROR);
+			evt.error = util::format("No response to %s", i->cmd.c_str());
+			evts.push_back(evt);
+			i = requests.erase(i);
+
+			if(stats) {
+				stats->givenUp();
+			}
+		}
+	}
+
+	if(ownBatch) {
+		endBatch();
+	}
+
+	armedDeadline = 0;
+	for(std::vector<Request>::const_iterator i(requests.begin()); i != requests.end(); ++i) {
+		if(!armedDeadline || i->deadline < armedDeadline) {
+			armedDeadline = i->deadline;
+		}
+	}
+
+	if(armedDeadline) {
+		timeoutTimer->startAt(armedDeadline);
+	}
+	else {
+		timeoutTimer->stop();
+	}
 }
 
-void Cat::gotEvent(CatEvt::EventType evt)
+void Cat::request(CatEvt::EventType evt, const std::string &cmd)
 {
-	// TODO this might trip, maybe it would be better to look for event in the whole vector? Or abandon it at all?
+	/* Already requested (maybe being retried), its response will do */
+	if(std::find_if(requests.begin(), requests.end(), [&cmd](const Request &req) { return req.cmd == cmd; }) != requests.end()) {
+		return;
+	}
+
+	const size_t size(cmd.size() + 1);
 
-	xassert(!expectedEvents.empty(), "Got CAT event %d, but not expecting any", evt);
-	xassert(expectedEvents[0] == evt, "Got CAT event %d, but expecting %d first", evt, expectedEvents[0]);
+	Request req;
+	req.type     = evt;
+	req.cmd      = cmd;
+	req.deadline = util::monotonicNs() + getTransmitNs(sendq.size() - sendPos + size) + RESPONSE_TIMEOUT_NS;
+	req.retries  = 0;
+	req.sendEnd  = sendq.size() + size;
+	req.sent     = 0;
 
-	expectedEvents.erase(expectedEvents.begin());
-	if(expectedEvents.empty()) {
+	/* Pending tuning will be written after this read */
+	req.stale = isTuningPending(evt);
+
+	/* Added before sending, so it's timestamped when written */
+	requests.push_back(req);
+	send("%s", cmd.c_str());
+
+	if(!armedDeadline || req.deadline < armedDeadline) {
+		armedDeadline = req.deadline;
+		timeoutTimer->startAt(armedDeadline);
+	}
+}
+
+bool Cat::gotResponse(std::string_view resp, CatEvt::EventType evt)
+{
+	/* Responses are matched by command code rather than by order, so a lost
+	 * response doesn't shift the following ones
+	 */
+	const std::vector<Request>::iterator i(std::find_if(requests.begin(), requests.end(), [resp](const Request &req) {
+		return resp.compare(0, req.cmd.size(), req.cmd) == 0;
+	}));
+
+	if(i == requests.end()) {
+		/* Recording is played back as it is, nothing is requested */
+		if(updates == CAT_UPDATES_REPLAY) {
+			return true;
+		}
+
+		/* In Auto-Information mode, frequency and mode are also sent
+		 * unsolicited; don't let the display jump back to a value older
+		 * than the pending one. Anything else is a late response to a
+		 * request which was already sent again.
+		 */
+		return updates == CAT_UPDATES_AUTO_INFO && (evt == CatEvt::EVT_FREQ || evt == CatEvt::EVT_MODE) && !isTuningPending(evt);
+	}
+
+	if(stats && i->sent) {
+		stats->rtt(i->cmd, util::monotonicNs() - i->sent);
+	}
+
+	/* Read before tuning, so it's outdated */
+	const bool stale(i->stale);
+	requests.erase(i);
+	if(requests.empty()) {
 		timeoutTimer->stop();
+		armedDeadline = 0;
+	}
+
+	return !stale;
+}
+
+bool Cat::isTuningPending(CatEvt::EventType evt) const
+{
+	switch(evt) {
+		case CatEvt::EVT_FREQ:
+			return pendingFreq || pendingBand;
+
+		case CatEvt::EVT_MODE:
+			return pendingMode || pendingBand;
+
+		default:
+			return false;
+	}
+}
+
+void Cat::markStale(CatEvt::EventType evt)
+{
+	for(std::vector<Request>::iterator i(requests.begin()); i != requests.end(); ++i) {
+		if(i->type == evt) {
+			i->stale = true;
+		}
 	}
 }
 
@@ -255,41 +641,86 @@ void Cat::send(const char *fmt, ...)
 	xassert(vasprintf(&p, fmt, ap) != -1, "Memory allocation error in vasprintf");
 	va_end(ap);
 
-	const std::string s(std::string(p) + ";");
+	if(sendPos == sendq.size()) {
+		queuedSince = util::monotonicNs();
+	}
+
+	sendq += p;
+	sendq += ';';
 	free(p);
 
-	const ssize_t rs(safewrite(fd, s.data(), s.size()));
-	xassert(rs == (ssize_t) s.size(), "CAT write error: %zd, %m", rs);
+	if(!batching) {
+		flush();
+	}
 }
 
-size_t Cat::saferead(int fd, void *buf, size_t count)
+void Cat::flush()
 {
-	ssize_t rs;
-	for(;;) {
-		rs = ::read(fd, buf, count);
-		if(rs == -1 && (errno == EAGAIN || errno == EINTR)) {
-			continue;
-		}
+	if(!isWritePending()) {
+		return;
+	}
 
-		break;
+	if(stats) {
+		stats->queued(sendq.size() - sendPos);
 	}
 
-	xassert(rs >= 0, "read(): rs=%zd, %m", rs);
-	return rs;
+	writeQueue();
 }
 
-size_t Cat::safewrite(int fd, const void *buf, size_t count)
+void Cat::writeQueue()
 {
-	ssize_t rs;
-	for(;;) {
-		rs = write(fd, buf, count);
-		if(rs == -1 && (errno == EAGAIN || errno == EINTR)) {
+	/* Drained already, for example earlier in the same batch of events;
+	 * there's no flush to measure then
+	 */
+	if(sendPos == sendq.size()) {
+		return;
+	}
+
+	/* Whatever doesn't fit in the driver's buffer now is written when
+	 * the fd becomes writable (see writeReady())
+	 */
+	while(sendPos < sendq.size()) {
+		const ssize_t rs(write(fd, sendq.data() + sendPos, sendq.size() - sendPos));
+		if(rs == -1 && errno == EINTR) {
 			continue;
 		}
 
-		break;
+		if(rs == -1 && errno == EAGAIN) {
+			return;
+		}
+
+		xassert(rs > 0, "CAT write error: %zd, %m", rs);
+		if(recorder) {
+			recorder->record(CatRecorder::DIR_TX, sendq.data() + sendPos, rs);
+		}
+
+		sendPos += rs;
+		if(stats) {
+			stats->sent(rs);
+		}
+
+		/* Round trip is measured from writing the last byte of the
+		 * command to the port
+		 */
+		const uint64_t now(util::monotonicNs());
+		for(std::vector<Request>::iterator i(requests.begin()); i != requests.end(); ++i) {
+			if(!i->sent && i->sendEnd <= sendPos) {
+				i->sent = now;
+			}
+		}
 	}
 
-	xassert(rs > 0, "write(): rs=%zd, %m", rs);
-	return (size_t) rs;
+	/* Only reached after the last byte was written by this call */
+	sendq.clear();
+	sendPos = 0;
+
+	if(stats) {
+		stats->flushed(util::monotonicNs() - queuedSince);
+	}
+}
+
+/* 10 bits per character: start, 8 data bits, stop */
+uint64_t Cat::getTransmitNs(size_t bytes) const
+{
+	return bytes * 10 * 1000000000ULL / baud;
 }
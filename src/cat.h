@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <optional>
 #include <vector>
 #include "fd.h"
@@ -9,6 +10,8 @@
 #include "mode.h"
 #include "fanmode.h"
 #include "meters.h"
+#include "catstats.h"
+#include "catrecorder.h"
 
 struct CatEvt {
 public:
@@ -29,35 +32,112 @@ public:
 	    : type(type) {}
 };
 
+/* Where frequency, mode and meters come from */
+enum CatUpdates {
+	CAT_UPDATES_POLL,      /* Everything is polled */
+	CAT_UPDATES_AUTO_INFO, /* Frequency and mode are sent by the radio (AI mode), meters are polled */
+	CAT_UPDATES_REPLAY,    /* Everything comes from a recording (see CatReplayer), nothing is requested */
+};
+
 class Cat {
 public:
-	Cat(const std::string &port, unsigned baud, Timer *timeoutTimer);
+	/* Stats and recorder are optional */
+	Cat(const std::string &port, unsigned baud, Timer *timeoutTimer, Timer *tuneTimer, CatStats *stats, CatRecorder *recorder, CatUpdates updates);
 	~Cat();
 
 	int getFd() const;
-	std::vector<CatEvt> read();
+
+	/* Replaces contents of evts; pass the same vector every time to avoid
+	 * allocations
+	 */
+	void read(std::vector<CatEvt> &evts);
+
+	/* Port is non-blocking; commands are queued and written as the port
+	 * accepts them. writeReady() has to be called when the fd becomes
+	 * writable, but only needs to be watched if isWritePending().
+	 */
+	void writeReady();
+	bool isWritePending() const;
+
+	/* Commands issued between beginBatch() and endBatch() are written to
+	 * the port at once, in endBatch(); responses are matched in order
+	 */
+	void beginBatch();
+	void endBatch();
+
+	/* Handles catTimeoutTimer expiration: requests without response are
+	 * sent again or, after a few retries, given up with EVT_ERROR
+	 */
+	void timeoutTimerExpired(std::vector<CatEvt> &evts);
+
+	/* True if every request was answered or timed out at least once;
+	 * retries of the latter may still be pending
+	 */
+	bool isFirstTryDone() const;
+	CatUpdates getUpdates() const;
 
 	void getMeter(meters::Meter meter);
 	void getFreq();
-	void setFreq(uint32_t freq);
 	void getMode();
+
+	/* Tuning commands are coalesced: if one was written recently (within
+	 * the time needed to transmit it), the new value replaces the pending
+	 * one and it's written when tuneTimer expires (see tuneTimerExpired())
+	 */
+	void setFreq(uint32_t freq);
 	void setBand(Band band);
 	void setMode(Mode mode);
+	void tuneTimerExpired();
+
 	void setFanMode(FanMode fanMode);
 	void swapVfo();
 	void zin();
+	void setTx(bool tx);
 
 private:
 	Fd fd;
+	const unsigned baud;
 	Timer *timeoutTimer;
-	std::vector<CatEvt::EventType> expectedEvents;
-	std::string recvq;
+	Timer *tuneTimer;
+	CatStats *stats;
+	CatRecorder *recorder;
+	const CatUpdates updates;
 
-	void expectEvent(CatEvt::EventType event);
-	void gotEvent(CatEvt::EventType event);
-	void send(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
-	std::vector<std::string> tokenizeRecvq();
+	/* Requests waiting for response */
+	struct Request {
+		CatEvt::EventType type;
+		std::string cmd;   /* Also the prefix of the response */
+		uint64_t deadline; /* util::monotonicNs() */
+		unsigned retries;
+		bool stale;        /* Sent before tuning, response carries old value */
+		size_t sendEnd;    /* Position in sendq after the command */
+		uint64_t sent;     /* When written to the port, 0 if not yet */
+	};
 
-	static size_t saferead(int fd, void *buf, size_t count);
-	static size_t safewrite(int fd, const void *buf, size_t count);
+	std::vector<Request> requests;
+	uint64_t armedDeadline{0};
+
+	/* Latest tuning values not written yet */
+	std::optional<uint32_t> pendingFreq;
+	std::optional<Band> pendingBand;
+	std::optional<Mode> pendingMode;
+	bool tuneHoldoff{false};
+
+	char recvBuf[1024];
+	size_t recvLen{0};
+	bool batching{false};
+	std::string sendq;
+	size_t sendPos{0};       /* Bytes of sendq already written */
+	uint64_t queuedSince{0}; /* When sendq became non-empty */
+
+	void request(CatEvt::EventType evt, const std::string &cmd);
+	bool gotResponse(std::string_view resp, CatEvt::EventType evt);
+	bool isTuningPending(CatEvt::EventType evt) const;
+	void markStale(CatEvt::EventType evt);
+	void flushTuning();
+	void send(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+	void flush();
+	void writeQueue();
+	uint64_t getTransmitNs(size_t bytes) const;
+	bool parseResponse(std::string_view resp, std::vector<CatEvt> &evts);
 };
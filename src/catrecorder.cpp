@@ -0,0 +1,51 @@
+#include "catrecorder.h"
+#include "throw.h"
+#include "util.h"
+
+const char CatRecorder::MAGIC[4] = {'C', 'R', 'C', 'T'};
+
+CatRecorder::CatRecorder(const std::string &path, unsigned baud)
+    : fp(fopen(path.c_str(), "wb")), prevTime(util::monotonicNs())
+{
+	xassert(fp, "Could not open CAT recording %s: %m", path.c_str());
+
+	const uint8_t header[] = {
+	    (uint8_t) MAGIC[0],
+	    (uint8_t) MAGIC[1],
+	    (uint8_t) MAGIC[2],
+	    (uint8_t) MAGIC[3],
+	    VERSION,
+	    (uint8_t) baud,
+	    (uint8_t) (baud >> 8),
+	    (uint8_t) (baud >> 16),
+	    (uint8_t) (baud >> 24),
+	};
+
+	xassert(fwrite(header, sizeof(header), 1, fp) == 1, "Could not write CAT recording header: %m");
+	xassert(fflush(fp) == 0, "Could not write CAT recording header: %m");
+}
+
+void CatRecorder::record(Direction dir, const void *data, size_t size)
+{
+	const uint64_t now(util::monotonicNs());
+	xassert(fputc(dir, fp) != EOF, "Could not write CAT recording: %m");
+	writeVarint((now - prevTime) / 1000);
+	writeVarint(size);
+	xassert(!size || fwrite(data, size, 1, fp) == 1, "Could not write CAT recording: %m");
+
+	/* Flushed every time, so the recording survives a crash */
+	xassert(fflush(fp) == 0, "Could not write CAT recording: %m");
+
+	/* Remainder is carried over, so rounding errors don't accumulate */
+	prevTime = now - (now - prevTime) % 1000;
+}
+
+void CatRecorder::writeVarint(uint64_t value)
+{
+	while(value >= 0x80) {
+		xassert(fputc((value & 0x7f) | 0x80, fp) != EOF, "Could not write CAT recording: %m");
+		value >>= 7;
+	}
+
+	xassert(fputc(value, fp) != EOF, "Could not write CAT recording: %m");
+}
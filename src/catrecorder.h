@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include "file.h"
+
+/* Records CAT traffic to a binary file, to be played back by CatReplayer.
+ *
+ * File format (integers are little-endian):
+ * - header: magic "CRCT", version (1 byte), baudrate (4 bytes)
+ * - records: direction (1 byte, DIR_TX or DIR_RX), time since the
+ *   previous record in microseconds (varint), data length (varint), data
+ *
+ * Varints are LEB128: 7 bits per byte, least significant group first,
+ * high bit set in all bytes but the last one.
+ */
+class CatRecorder {
+public:
+	enum Direction {
+		DIR_TX = 0,
+		DIR_RX = 1,
+	};
+
+	static const char MAGIC[4];
+	static const uint8_t VERSION = 1;
+
+	CatRecorder(const std::string &path, unsigned baud);
+
+	void record(Direction dir, const void *data, size_t size);
+
+private:
+	File fp;
+	uint64_t prevTime;
+
+	void writeVarint(uint64_t value);
+};
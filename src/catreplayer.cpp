@@ -0,0 +1,170 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "catreplayer.h"
+#include "catrecorder.h"
+#include "file.h"
+#include "throw.h"
+#include "util.h"
+
+static uint64_t readVarint(FILE *fp)
+{
+	uint64_t value(0);
+	for(unsigned shift(0);; shift += 7) {
+		xassert(shift < 64, "Invalid varint in CAT recording");
+
+		const int c(fgetc(fp));
+		xassert(c != EOF, "CAT recording truncated");
+		value |= (uint64_t) (c & 0x7f) << shift;
+		if(!(c & 0x80)) {
+			return value;
+		}
+	}
+}
+
+CatReplayer::CatReplayer(const std::string &path, double speed, Timer *timer)
+    : fd(posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK)), speed(speed), timer(timer)
+{
+	xassert(fd != -1, "Could not open pseudo-terminal: %m");
+	xassert(grantpt(fd) == 0 && unlockpt(fd) == 0, "Could not unlock pseudo-terminal: %m");
+	xassert(speed >= 0, "Invalid replay speed: %f", speed);
+	xassert(timer, "timer is nullptr");
+
+	load(path);
+	startTime = util::monotonicNs();
+	schedule();
+}
+
+void CatReplayer::load(const std::string &path)
+{
+	File fp(fopen(path.c_str(), "rb"));
+	xassert(fp, "Could not open CAT recording %s: %m", path.c_str());
+
+	uint8_t header[9];
+	xassert(fread(header, sizeof(header), 1, fp) == 1, "CAT recording %s too short", path.c_str());
+	xassert(!memcmp(header, CatRecorder::MAGIC, sizeof(CatRecorder::MAGIC)), "%s is not a CAT recording", path.c_str());
+	xassert(header[4] == CatRecorder::VERSION, "CAT recording version %u not supported", header[4]);
+	baud = header[5] | (header[6] << 8) | (header[7] << 16) | ((unsigned) header[8] << 24);
+
+	/* Only data received from the radio is kept; time of data sent to it
+	 * still counts
+	 */
+	uint64_t time(0);
+	int dir;
+	while((dir = fgetc(fp)) != EOF) {
+		xassert(dir == CatRecorder::DIR_TX || dir == CatRecorder::DIR_RX, "Invalid record type %d in CAT recording", dir);
+		time += readVarint(fp);
+
+		Record r;
+		r.time = time;
+		r.data.resize(readVarint(fp));
+		xassert(r.data.empty() || fread(&r.data[0], r.data.size(), 1, fp) == 1, "CAT recording truncated");
+
+		if(dir == CatRecorder::DIR_RX) {
+			records.push_back(r);
+		}
+	}
+}
+
+std::string CatReplayer::getPortName() const
+{
+	const char *name(ptsname(fd));
+	xassert(name, "Could not get pseudo-terminal name: %m");
+	return name;
+}
+
+unsigned CatReplayer::getBaud() const
+{
+	return baud;
+}
+
+int CatReplayer::getFd() const
+{
+	return fd;
+}
+
+void CatReplayer::read()
+{
+	char buf[1024];
+	ssize_t rs;
+	do {
+		rs = ::read(fd, buf, sizeof(buf));
+	} while(rs == -1 && errno == EINTR);
+
+	/* EIO means Cat closed the port, nothing to discard */
+	xassert(rs != -1 || errno == EAGAIN || errno == EIO, "Could not read from pseudo-terminal: %m");
+}
+
+bool CatReplayer::timerExpired()
+{
+	while(recordPos < records.size()) {
+		const Record &r(records[recordPos]);
+		const uint64_t deadline(startTime + (speed ? r.time * 1000 / speed : 0));
+		if(deadline > util::monotonicNs()) {
+			break;
+		}
+
+		const ssize_t rs(write(fd, r.data.data() + dataPos, r.data.size() - dataPos));
+		if(rs == -1 && (errno == EAGAIN || errno == EINTR)) {
+			/* Cat didn't keep up, try again soon */
+			timer->start(1);
+			return true;
+		}
+
+		xassert(rs > 0, "Could not write to pseudo-terminal: %zd, %m", rs);
+		dataPos += rs;
+		bytes += rs;
+		if(dataPos < r.data.size()) {
+			continue;
+		}
+
+		dataPos = 0;
+		recordPos++;
+
+		/* One record at a time, so the data is read in the same chunks
+		 * as when it was recorded
+		 */
+		break;
+	}
+
+	if(recordPos == records.size()) {
+		endTime = util::monotonicNs();
+		return false;
+	}
+
+	schedule();
+	return true;
+}
+
+void CatReplayer::schedule()
+{
+	if(recordPos == records.size()) {
+		/* Nothing to play, let timerExpired() report it */
+		timer->start(0);
+		return;
+	}
+
+	const uint64_t time(records[recordPos].time);
+	timer->startAt(startTime + (speed ? time * 1000 / speed : 0));
+}
+
+void CatReplayer::processed(uint64_t ns)
+{
+	processingTime += ns;
+}
+
+std::vector<std::string> CatReplayer::getReport() const
+{
+	std::vector<std::string> rs;
+	const uint64_t elapsed((endTime ? endTime : util::monotonicNs()) - startTime);
+	rs.push_back(util::format("CAT replay: %zu of %zu records (%zu bytes) played in %.1f ms%s",
+	    recordPos, records.size(), bytes, elapsed / 1e6, endTime ? "" : ", not finished"));
+
+	if(recordPos) {
+		rs.push_back(util::format("  Reading and parsing: %.1f ms, %.2f us per record",
+		    processingTime / 1e6, processingTime / 1e3 / recordPos));
+	}
+
+	return rs;
+}
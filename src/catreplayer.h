@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "fd.h"
+#include "timer.h"
+
+/* Plays back a recording made by CatRecorder. Data received from the radio
+ * is written, with its original timing scaled by speed, to a pseudo-terminal,
+ * which is then opened by Cat as if it was the radio port. Data written by
+ * Cat is discarded.
+ */
+class CatReplayer {
+public:
+	/* Speed 1 is real time, 0 is as fast as possible */
+	CatReplayer(const std::string &path, double speed, Timer *timer);
+
+	/* Port to be opened by Cat, and baudrate it was recorded with */
+	std::string getPortName() const;
+	unsigned getBaud() const;
+
+	/* Readable when Cat writes something */
+	int getFd() const;
+	void read();
+
+	/* Has to be called when timer expires. Returns false if there's
+	 * nothing more to play.
+	 */
+	bool timerExpired();
+
+	/* Time spent by Cat reading and parsing played back data */
+	void processed(uint64_t ns);
+
+	std::vector<std::string> getReport() const;
+
+private:
+	struct Record {
+		uint64_t time; /* Microseconds since the beginning of the recording */
+		std::string data;
+	};
+
+	Fd fd;
+	const double speed;
+	Timer *timer;
+	unsigned baud;
+	std::vector<Record> records;
+	size_t recordPos{0};
+	size_t dataPos{0};
+	uint64_t startTime{0};
+	uint64_t endTime{0};
+	uint64_t processingTime{0};
+	size_t bytes{0};
+
+	void load(const std::string &path);
+	void schedule();
+};
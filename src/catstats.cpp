@@ -0,0 +1,108 @@
+#include "catstats.h"
+#include "util.h"
+
+/* In bytes */
+static const std::vector<int64_t> depthBounds = {
+    8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+/* In microseconds */
+static const std::vector<int64_t> latencyBounds = {
+    10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000};
+
+/* In microseconds */
+static const std::vector<int64_t> rttBounds = {
+    500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000};
+
+CatStats::CatStats()
+    : queueDepth(depthBounds), flushLatency(latencyBounds), pollLate(latencyBounds)
+{
+}
+
+void CatStats::started(unsigned baud_)
+{
+	baud      = baud_;
+	startTime = util::monotonicNs();
+}
+
+void CatStats::sent(size_t bytes)
+{
+	bytesSent += bytes;
+}
+
+void CatStats::received(size_t bytes)
+{
+	bytesReceived += bytes;
+}
+
+void CatStats::rtt(const std::string &cmd, uint64_t ns)
+{
+	std::unique_ptr<Histogram> &h(rtts[cmd]);
+	if(!h) {
+		h.reset(new Histogram(rttBounds));
+	}
+
+	h->add(ns / 1000);
+}
+
+void CatStats::retry()
+{
+	retries++;
+}
+
+void CatStats::givenUp()
+{
+	givenUps++;
+}
+
+void CatStats::invalid()
+{
+	invalids++;
+}
+
+void CatStats::queued(size_t depth)
+{
+	queueDepth.add(depth);
+}
+
+void CatStats::flushed(uint64_t latencyNs)
+{
+	flushLatency.add(latencyNs / 1000);
+}
+
+void CatStats::pollLateness(uint64_t ns)
+{
+	pollLate.add(ns / 1000);
+}
+
+std::vector<std::string> CatStats::getReport() const
+{
+	std::vector<std::string> rs;
+	if(!baud) {
+		rs.push_back("CAT link: not started");
+		return rs;
+	}
+
+	/* 10 bits per character: start, 8 data bits, stop */
+	const double elapsed((util::monotonicNs() - startTime) / 1e9);
+	const double capacity(elapsed * baud / 10);
+
+	rs.push_back(util::format("CAT link at %u bps, %.1f s:", baud, elapsed));
+	rs.push_back(util::format("  Sent %lu B (%.1f%% of link capacity), received %lu B (%.1f%%)",
+	    (unsigned long) bytesSent,
+	    capacity ? bytesSent * 100 / capacity : 0,
+	    (unsigned long) bytesReceived,
+	    capacity ? bytesReceived * 100 / capacity : 0));
+	rs.push_back(util::format("  Retries: %lu, given up: %lu, invalid responses: %lu",
+	    (unsigned long) retries,
+	    (unsigned long) givenUps,
+	    (unsigned long) invalids));
+
+	for(std::map<std::string, std::unique_ptr<Histogram> >::const_iterator i(rtts.begin()); i != rtts.end(); ++i) {
+		i->second->report("Round trip " + i->first, "us", rs);
+	}
+
+	queueDepth.report("Write queue depth", "B", rs);
+	flushLatency.report("Write queue flush latency", "us", rs);
+	pollLate.report("Poll timer lateness", "us", rs);
+	return rs;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include "histogram.h"
+
+/* CAT link statistics:
+ * - round-trip time of every query, per command (from writing the command
+ *   to the port to reading the response from it)
+ * - bytes sent and received, and how much of the link capacity it took
+ * - retries, given up queries and invalid responses
+ * - depth of the outbound queue when commands are queued for writing, and
+ *   flush latency (time from queueing the first byte to writing the last
+ *   one, when the queue becomes empty again)
+ * - poll timer lateness (time the poll was started minus time it was
+ *   scheduled for), which shows how busy the main loop is
+ */
+class CatStats {
+public:
+	CatStats();
+
+	void started(unsigned baud);
+	void sent(size_t bytes);
+	void received(size_t bytes);
+	void rtt(const std::string &cmd, uint64_t ns);
+	void retry();
+	void givenUp();
+	void invalid();
+	void queued(size_t depth);
+	void flushed(uint64_t latencyNs);
+	void pollLateness(uint64_t ns);
+
+	std::vector<std::string> getReport() const;
+
+private:
+	unsigned baud{0};
+	uint64_t startTime{0};
+	uint64_t bytesSent{0};
+	uint64_t bytesReceived{0};
+	uint64_t retries{0};
+	uint64_t givenUps{0};
+	uint64_t invalids{0};
+	std::map<std::string, std::unique_ptr<Histogram> > rtts;
+	Histogram queueDepth;
+	Histogram flushLatency;
+	Histogram pollLate;
+};
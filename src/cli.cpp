@@ -14,15 +14,25 @@ void Cli::help()
 	    "  -v: show version and exit\n"
 	    "  -s <callsign>: your callsign (for presets and logging)\n"
 	    "  -f <file>: Cabrillo file for logging\n"
+	    "  -D <rule>: dupe rule: call (default), band or bandmode\n"
+	    "  -k <file>: known callsigns file (MASTER.SCP format)\n"
 	    "  -c <port>: radio CAT port\n"
 	    "  -b <rate>: radio CAT port baudrate\n"
+	    "  -a: use CAT Auto-Information mode instead of polling frequency and mode\n"
+	    "  -t <file>: record CAT traffic to a file\n"
+	    "  -T <file>: play back recorded CAT traffic instead of using CAT port\n"
+	    "  -x <factor>: playback speed (1 is real time, 0 is as fast as possible)\n"
+	    "  -m <meters>: comma-separated list of meters to read (default: all)\n"
 	    "  -p <port>: radio PTT port\n"
 	    "  -w <wpm>: initial keyer speed\n"
+	    "  -r: key CW from a dedicated real-time thread\n"
 	    "  -P <prefix>: contest exchange prefix\n"
 	    "  -I <infix>: contest exchange infix\n"
 	    "  -S <suffix>: contest exchange suffix\n"
 	    "  -U <host>: UDP broadcast host\n"
 	    "  -u <port>: UDP broadcast port\n"
+	    "  -N <port>: rigctld-compatible TCP server port (on localhost)\n"
+	    "  -R: print timing statistics on exit\n"
 	    "\n"
 	    "Exchange prefix and suffix are fixed parts of the exchange. They can \n"
 	    "be skipped if only numbers are exchanged.\n"
@@ -33,13 +43,18 @@ void Cli::help()
 	    "length of the exchange (for example, 001).\n"
 	    "\n"
 	    "If Cabrillo file is specified, then header and footer has to be added \n"
-	    "to it manually. Program rereads and rewrites Cabrillo file every time \n"
-	    "a QSO is logged.\n"
+	    "to it manually. Logged QSOs are indexed in memory, and new QSOs are \n"
+	    "only appended to the file; changes made to it by other programs are \n"
+	    "picked up before every check.\n"
 	    "\n"
 	    "If callsign is not specified, then presets and logging will be disabled.\n"
 	    "If Cabrillo file is not specified, then logging will be disabled.\n"
 	    "If CAT port is not specified, then radio functions will be disabled.\n"
 	    "\n"
+	    "To use more than one radio, repeat -c, -b and -p for every radio; an \n"
+	    "option given again starts the next radio. Other options apply to all \n"
+	    "radios.\n"
+	    "\n"
 	    "UDP broadcast is for integration with remote ATU. More info in future\n"
 	    "versions.\n";
 
@@ -56,7 +71,7 @@ void Cli::version()
 Cli::Cli(int argc, char *const argv[])
 {
 	int opt;
-	while((opt = getopt(argc, argv, ":hvs:f:c:b:p:w:P:I:S:U:u:")) != -1 && !exitFlag) {
+	while((opt = getopt(argc, argv, ":hvs:f:D:k:c:b:at:T:x:m:p:w:rP:I:S:U:u:N:R")) != -1 && !exitFlag) {
 		switch(opt) {
 			case '?':
 				xthrow("-%c: option not recognized", optopt);
@@ -84,17 +99,48 @@ Cli::Cli(int argc, char *const argv[])
 				cbrFile = optarg;
 				break;
 
+			case 'D':
+				/* No sanity checking, logger module will do it */
+				dupeRule = optarg;
+				break;
+
+			case 'k':
+				scpFile = optarg;
+				break;
+
 			case 'c':
-				catPort = optarg;
+				getRadioFor(&RadioPorts::catPort).catPort = optarg;
 				break;
 
 			case 'b':
 				/* No sanity checking, cat class will do it */
-				catBaud = atoi(optarg);
+				getRadioFor(&RadioPorts::catBaud).catBaud = atoi(optarg);
+				break;
+
+			case 'a':
+				autoInfo = true;
+				break;
+
+			case 't':
+				catRecording = optarg;
+				break;
+
+			case 'T':
+				catReplay = optarg;
+				break;
+
+			case 'x':
+				/* No sanity checking, replayer class will do it */
+				replaySpeed = atof(optarg);
+				break;
+
+			case 'm':
+				/* No sanity checking, meters module will do it */
+				meterSet = optarg;
 				break;
 
 			case 'p':
-				pttPort = optarg;
+				getRadioFor(&RadioPorts::pttPort).pttPort = optarg;
 				break;
 
 			case 'w':
@@ -102,6 +148,10 @@ Cli::Cli(int argc, char *const argv[])
 				wpm = atoi(optarg);
 				break;
 
+			case 'r':
+				rtKeying = true;
+				break;
+
 			case 'P':
 				prefix = optarg;
 				break;
@@ -122,6 +172,14 @@ Cli::Cli(int argc, char *const argv[])
 				bcastPort = optarg;
 				break;
 
+			case 'N':
+				rigctldPort = optarg;
+				break;
+
+			case 'R':
+				report = true;
+				break;
+
 			default:
 				xthrow("Unknown value returned by getopt(): %d", opt);
 				break;
@@ -129,6 +187,11 @@ Cli::Cli(int argc, char *const argv[])
 	}
 
 	xassert(optind == argc, "Excessive arguments");
+	for(std::vector<RadioPorts>::const_iterator i(radios.begin()); i != radios.end(); ++i) {
+		xassert(i->catPort.empty() || catReplay.empty(), "CAT port and CAT playback can't be used at once");
+	}
+
+	xassert(radios.size() <= 1 || (catRecording.empty() && catReplay.empty()), "CAT recording and playback work only with one radio");
 }
 
 bool Cli::shouldExit() const
@@ -136,19 +199,45 @@ bool Cli::shouldExit() const
 	return exitFlag;
 }
 
-std::string Cli::getCatPort() const
+template<typename T>
+Cli::RadioPorts &Cli::getRadioFor(T RadioPorts::*field)
+{
+	/* Option given again starts the next radio */
+	if(radios.empty() || radios.back().*field != T()) {
+		radios.push_back(RadioPorts());
+	}
+
+	return radios.back();
+}
+
+const std::vector<Cli::RadioPorts> &Cli::getRadios() const
 {
-	return catPort;
+	return radios;
 }
 
-std::string Cli::getPttPort() const
+bool Cli::getAutoInfo() const
 {
-	return pttPort;
+	return autoInfo;
 }
 
-unsigned Cli::getCatBaud() const
+std::string Cli::getCatRecording() const
 {
-	return catBaud;
+	return catRecording;
+}
+
+std::string Cli::getCatReplay() const
+{
+	return catReplay;
+}
+
+double Cli::getReplaySpeed() const
+{
+	return replaySpeed;
+}
+
+std::string Cli::getMeterSet() const
+{
+	return meterSet;
 }
 
 std::string Cli::getCbrFile() const
@@ -156,6 +245,16 @@ std::string Cli::getCbrFile() const
 	return cbrFile;
 }
 
+std::string Cli::getDupeRule() const
+{
+	return dupeRule;
+}
+
+std::string Cli::getScpFile() const
+{
+	return scpFile;
+}
+
 std::string Cli::getCallsign() const
 {
 	return callsign;
@@ -186,7 +285,22 @@ std::string Cli::getBcastPort() const
 	return bcastPort;
 }
 
+std::string Cli::getRigctldPort() const
+{
+	return rigctldPort;
+}
+
 unsigned Cli::getWpm() const
 {
 	return wpm;
 }
+
+bool Cli::getRtKeying() const
+{
+	return rtKeying;
+}
+
+bool Cli::getReport() const
+{
+	return report;
+}
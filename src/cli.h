@@ -1,37 +1,64 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 class Cli {
 public:
+	/* Ports of one radio; empty port or zero baudrate if not given */
+	struct RadioPorts {
+		std::string catPort;
+		unsigned catBaud{0};
+		std::string pttPort;
+	};
+
 	Cli(int argc, char *const argv[]);
 
 	bool shouldExit() const;
-	std::string getCatPort() const;
-	unsigned getCatBaud() const;
-	std::string getPttPort() const;
+	const std::vector<RadioPorts> &getRadios() const;
+	bool getAutoInfo() const;
+	std::string getCatRecording() const;
+	std::string getCatReplay() const;
+	double getReplaySpeed() const;
+	std::string getMeterSet() const;
 	std::string getCbrFile() const;
+	std::string getDupeRule() const;
+	std::string getScpFile() const;
 	std::string getCallsign() const;
 	std::string getPrefix() const;
 	std::string getInfix() const;
 	std::string getSuffix() const;
 	std::string getBcastHost() const;
 	std::string getBcastPort() const;
+	std::string getRigctldPort() const;
 	unsigned getWpm() const;
+	bool getRtKeying() const;
+	bool getReport() const;
 
 private:
 	bool exitFlag{false};
-	std::string catPort;
-	unsigned catBaud{0};
-	std::string pttPort;
+	std::vector<RadioPorts> radios;
+	bool autoInfo{false};
+	std::string catRecording;
+	std::string catReplay;
+	double replaySpeed{1};
+	std::string meterSet;
 	std::string cbrFile;
+	std::string dupeRule;
+	std::string scpFile;
 	std::string callsign;
 	std::string prefix;
 	std::string infix;
 	std::string suffix;
 	std::string bcastHost;
 	std::string bcastPort;
+	std::string rigctldPort;
 	unsigned wpm{0};
+	bool rtKeying{false};
+	bool report{false};
+
+	template<typename T>
+	RadioPorts &getRadioFor(T RadioPorts::*field);
 
 	void help();
 	void version();
@@ -10,17 +10,23 @@
 #include "util.h"
 
 static const unsigned DEFAULT_WPM         = 25;
-static const unsigned METER_POLL_INTERVAL = 100;
-static const unsigned CAT_TIMEOUT         = 2000;
 static const int32_t TUNE_INCREMENT_SLOW  = 10;
 static const int32_t TUNE_INCREMENT_NORM  = 100;
 static const int32_t TUNE_INCREMENT_FAST  = 1000;
 static const int32_t TUNE_INCREMENT_XFAST = 10000;
+static const size_t MAX_KNOWN_CALLS_SHOWN = 40;
+static const size_t MAX_SUGGESTIONS       = 40;
 
 void CurseRadio::run(const Cli &cli)
 {
 	signal(SIGPIPE, SIG_IGN);
-	std::set<int> inrfds{ui.getFd()};
+
+	bool quit(false);
+	reactor.add(ui.getFd(), [this, &quit]() {
+		if(uiEvt(ui.read())) {
+			quit = true;
+		}
+	});
 
 	if(!cli.getPrefix().empty() || !cli.getInfix().empty() || !cli.getSuffix().empty()) {
 		exchange.reset(new Exchange(cli.getPrefix(), cli.getInfix(), cli.getSuffix()));
@@ -30,87 +36,151 @@ void CurseRadio::run(const Cli &cli)
 		presets.reset(new Presets(cli.getCallsign()));
 	}
 
-	if(!cli.getCatPort().empty()) {
-		catTimeoutTimer.reset(new Timer(CAT_TIMEOUT));
-		inrfds.insert(catTimeoutTimer->getFd());
+	const CatUpdates catUpdates(cli.getAutoInfo() ? CAT_UPDATES_AUTO_INFO : CAT_UPDATES_POLL);
+	const std::set<meters::Meter> meterSet(meters::parseSet(cli.getMeterSet()));
+	const DupeRule dupeRule(parseDupeRule(cli.getDupeRule()));
+	const unsigned wpm(cli.getWpm() ? cli.getWpm() : DEFAULT_WPM);
 
-		cat.reset(new Cat(cli.getCatPort(), cli.getCatBaud(), catTimeoutTimer.get()));
-		inrfds.insert(cat->getFd());
+	if(!cli.getBcastHost().empty() && !cli.getBcastPort().empty()) {
+		bcast.reset(new Broadcaster(cli.getBcastHost(), cli.getBcastPort()));
+	}
 
-		catMeterTimer.reset(new Timer(METER_POLL_INTERVAL));
-		inrfds.insert(catMeterTimer->getFd());
-		catMeterTimer->start();
+	std::vector<Cli::RadioPorts> ports(cli.getRadios());
+	if(ports.empty()) {
+		/* Radio without CAT and PTT, so commands can tell what's disabled */
+		ports.push_back(Cli::RadioPorts());
 	}
 
-	if(!cli.getPttPort().empty()) {
-		ptt.reset(new Ptt(cli.getPttPort()));
-		keyer.reset(new Keyer(cli.getWpm() ? cli.getWpm() : DEFAULT_WPM));
-		inrfds.insert(keyer->getFd());
+	if(!cli.getCatReplay().empty()) {
+		catReplayTimer.reset(new Timer());
+		catReplayer.reset(new CatReplayer(cli.getCatReplay(), cli.getReplaySpeed(), catReplayTimer.get()));
+		reactor.add(catReplayTimer->getFd(), [this]() {
+			if(catReplayTimer->read() && !catReplayer->timerExpired()) {
+				const std::vector<std::string> report(catReplayer->getReport());
+				ui.print("%s", report[0].c_str());
+			}
+		});
+		reactor.add(catReplayer->getFd(), [this]() { catReplayer->read(); });
 	}
 
-	if(exchange && cat && !cli.getCallsign().empty() && !cli.getCbrFile().empty()) {
-		logger.reset(new Logger(cli.getCallsign(), cli.getCbrFile()));
+	for(size_t i(0); i < ports.size(); ++i) {
+		Radio::Config config;
+		config.number       = i + 1;
+		config.tagged       = ports.size() > 1;
+		config.catPort      = ports[i].catPort;
+		config.catBaud      = ports[i].catBaud;
+		config.catUpdates   = catUpdates;
+		config.meters       = meterSet;
+		config.catRecording = cli.getCatRecording();
+		config.pttPort      = ports[i].pttPort;
+		config.wpm          = wpm;
+		config.rtKeying     = cli.getRtKeying();
+
+		/* Playback works only with one radio (see Cli) */
+		if(catReplayer && i == 0) {
+			config.catPort     = catReplayer->getPortName();
+			config.catBaud     = catReplayer->getBaud();
+			config.catUpdates  = CAT_UPDATES_REPLAY;
+			config.catReplayer = catReplayer.get();
+		}
+
+		/* Only the first radio is reported to the remote ATU */
+		radios.push_back(std::unique_ptr<Radio>(new Radio(config, &reactor, &ui, i == 0 ? bcast.get() : nullptr)));
 	}
 
-	if(!cli.getBcastHost().empty() && !cli.getBcastPort().empty()) {
-		bcast.reset(new Broadcaster(cli.getBcastHost(), cli.getBcastPort()));
+	radios[focus]->setFocus(true);
+
+	bool anyCat(false);
+	for(std::vector<std::unique_ptr<Radio> >::const_iterator i(radios.begin()); i != radios.end(); ++i) {
+		anyCat |= (*i)->getCat() != nullptr;
 	}
 
-	for(;;) {
-		const std::set<int> outrfds(util::watch(inrfds, -1));
-		if(util::inSet(outrfds, ui.getFd()) && uiEvt(ui.read())) {
-			break;
-		}
+	if(!cli.getRigctldPort().empty()) {
+		/* Only the first radio is served */
+		xassert(radios[0]->getCat(), "rigctld server requires CAT port");
+		rigServer.reset(new RigServer(cli.getRigctldPort(), &reactor, radios[0].get(), [this]() { return checkTxLock(0); }));
+	}
 
-		if(cat && util::inSet(outrfds, cat->getFd())) {
-			const std::vector<CatEvt> evts(cat->read());
-			for(std::vector<CatEvt>::const_iterator i(evts.begin()); i != evts.end(); ++i) {
-				catEvt(*i);
-			}
-		}
+	if(exchange && anyCat && !cli.getCallsign().empty() && !cli.getCbrFile().empty()) {
+		logger.reset(new Logger(cli.getCallsign(), cli.getCbrFile(), dupeRule));
+	}
 
-		if(keyer && util::inSet(outrfds, keyer->getFd())) {
-			keyerEvt(keyer->read());
-		}
+	if(!cli.getScpFile().empty()) {
+		scp.reset(new Scp(cli.getScpFile()));
+		ui.print("Loaded %zu known callsigns from %s in %.1f ms%s", scp->getSize(), cli.getScpFile().c_str(), scp->getLoadTime() / 1e6,
+		    scp->getSkipped() ? util::format(" (%zu invalid lines skipped)", scp->getSkipped()).c_str() : "");
+	}
 
-		if(catMeterTimer && util::inSet(outrfds, catMeterTimer->getFd()) && catMeterTimer->read()) {
-			cat->getMeter(meters::METER_IDD);
-		}
+	if(logger || scp) {
+		suggester.reset(new CallSuggester(logger.get(), scp.get()));
+		ui.showSuggestions();
+	}
 
-		if(catTimeoutTimer && util::inSet(outrfds, catTimeoutTimer->getFd()) && catTimeoutTimer->read()) {
-			xthrow("CAT timeout");
+	while(!quit) {
+		for(std::vector<std::unique_ptr<Radio> >::const_iterator i(radios.begin()); i != radios.end(); ++i) {
+			(*i)->prepareWait();
 		}
+
+		reactor.wait(-1);
 	}
 }
 
-void CurseRadio::broadcastFreq()
+std::vector<std::string> CurseRadio::getReport() const
 {
-	xassert(curFreq, "Expecting frequency at this point");
+	std::vector<std::string> rs;
+	for(std::vector<std::unique_ptr<Radio> >::const_iterator i(radios.begin()); i != radios.end(); ++i) {
+		const std::vector<std::string> radioReport((*i)->getReport());
+		rs.insert(rs.end(), radioReport.begin(), radioReport.end());
+	}
 
-	if(!bcast) {
-		return;
+	if(catReplayer) {
+		const std::vector<std::string> replayReport(catReplayer->getReport());
+		rs.insert(rs.end(), replayReport.begin(), replayReport.end());
 	}
 
-	BroadcastPacket p("freq_rsp");
-	p.add("freq", util::format("%u", curFreq.value()));
-	bcast->sendPacket(p);
+	return rs;
 }
 
-void CurseRadio::broadcastMode()
+bool CurseRadio::checkTxLock(size_t radio)
 {
-	xassert(curMode, "Expecting mode at this point");
+	for(size_t i(0); i < radios.size(); ++i) {
+		if(i != radio && radios[i]->isTransmitting()) {
+			ui.print("%s is transmitting", radios[i]->getName().c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
 
-	if(!bcast) {
+void CurseRadio::checkKnownCalls(const std::string &part)
+{
+	std::vector<uint32_t> found;
+	scp->find(part, found);
+	if(found.empty()) {
+		ui.print("No known callsigns contain %s", part.c_str());
 		return;
 	}
 
-	BroadcastPacket p("mode_rsp");
-	p.add("mode", getModeName(curMode.value()));
-	bcast->sendPacket(p);
+	std::string s;
+	for(size_t i(0); i < found.size() && i < MAX_KNOWN_CALLS_SHOWN; ++i) {
+		s += ' ';
+		s += scp->getCall(found[i]);
+	}
+
+	if(found.size() > MAX_KNOWN_CALLS_SHOWN) {
+		s += util::format(" (and %zu more)", found.size() - MAX_KNOWN_CALLS_SHOWN);
+	}
+
+	ui.print("Known callsigns containing %s:%s", part.c_str(), s.c_str());
 }
 
 bool CurseRadio::uiEvt(const UiEvt &evt)
 {
+	Radio &radio(*radios[focus]);
+	Cat *cat(radio.getCat());
+	Keyer *keyer(radio.getKeyer());
+
 	switch(evt.type) {
 		case UiEvt::EVT_NONE:
 			break;
@@ -132,12 +202,12 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 				break;
 			}
 
-			if(!curFreq) {
+			if(!radio.getFreq()) {
 				ui.print("Current frequency unknown yet");
 				break;
 			}
 
-			uint32_t newFreq(curFreq.value());
+			uint32_t newFreq(radio.getFreq().value());
 			int32_t increment(0);
 			const Band band(band::getBandByFreq(newFreq));
 
@@ -193,8 +263,7 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 				}
 			}
 
-			cat->setFreq(newFreq);
-			curFreq = newFreq;
+			radio.setFreq(newFreq);
 			break;
 		}
 
@@ -217,7 +286,7 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 				break;
 			}
 
-			cat->setMode(evt.mode.value());
+			radio.setMode(evt.mode.value());
 			break;
 
 		case UiEvt::EVT_FAN_MODE:
@@ -241,6 +310,18 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 			cat->swapVfo();
 			break;
 
+		case UiEvt::EVT_NEXT_RADIO:
+			if(radios.size() < 2) {
+				ui.print("Only one radio");
+				break;
+			}
+
+			radio.setFocus(false);
+			focus = (focus + 1) % radios.size();
+			radios[focus]->setFocus(true);
+			ui.print("Switched to %s", radios[focus]->getName().c_str());
+			break;
+
 		case UiEvt::EVT_SHOW_PRESETS:
 			if(!presets || !exchange) {
 				ui.print("Preset support disabled");
@@ -269,9 +350,16 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 				--presetNo;
 			}
 
+			if(!checkTxLock(focus)) {
+				ui.print("Preset not sent");
+				break;
+			}
+
 			const std::string preset(presets->getPreset(presetNo, exchange->get()));
 			ui.print("Sending preset: %s", preset.c_str());
-			keyer->send(preset);
+			if(!keyer->send(preset)) {
+				ui.print("Keyer queue full, preset not sent");
+			}
 			break;
 		}
 
@@ -285,12 +373,23 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 
 		case UiEvt::EVT_CHECK_CALL:
 			xassert(evt.checkCall, "Expecting checkCall field");
-			if(!logger) {
-				ui.print("Cannot check call -- logging disabled");
+			if(!logger && !scp) {
+				ui.print("Cannot check call -- logging disabled and no known callsigns");
 				break;
 			}
 
-			logger->checkIfExists(&ui, evt.checkCall.value(), false);
+			if(logger) {
+				logger->checkIfExists(&ui, evt.checkCall.value(), false);
+				if(logger->getDupeRule() != DUPE_CALL && radio.getFreq() && radio.getMode()) {
+					ui.print("Callsign %s %s %s", evt.checkCall.value().c_str(),
+					    logger->isDupe(evt.checkCall.value(), radio.getFreq().value(), radio.getMode().value()) ? "is a dupe" : "not worked yet",
+					    getDupeRuleScope(logger->getDupeRule()));
+				}
+			}
+
+			if(scp) {
+				checkKnownCalls(evt.checkCall.value());
+			}
 			break;
 
 		case UiEvt::EVT_LOG: {
@@ -301,13 +400,13 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 				break;
 			}
 
-			if(!curFreq || !curMode) {
+			if(!radio.getFreq() || !radio.getMode()) {
 				ui.print("Current freq or mode unknown yet (no CAT?), cannot log");
 				break;
 			}
 
-			if(logger->checkIfExists(nullptr, evt.logCall.value(), true)) {
-				ui.print("Warning: call %s already exists in log", evt.logCall.value().c_str());
+			if(logger->isDupe(evt.logCall.value(), radio.getFreq().value(), radio.getMode().value())) {
+				ui.print("Warning: call %s already worked %s", evt.logCall.value().c_str(), getDupeRuleScope(logger->getDupeRule()));
 			}
 
 			Logger::Entry e;
@@ -319,8 +418,8 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 				e.ts = time(nullptr);
 			}
 
-			e.freq = curFreq.value();
-			e.mode = curMode.value();
+			e.freq = radio.getFreq().value();
+			e.mode = radio.getMode().value();
 			if(e.mode == MODE_CW_1 || e.mode == MODE_CW_2) {
 				e.sentRst = "599";
 			}
@@ -351,6 +450,20 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 			frozenTime = time(nullptr);
 			break;
 
+		case UiEvt::EVT_PARTIAL_CALL: {
+			xassert(evt.partialCall, "Expecting partialCall field");
+			if(!suggester) {
+				break;
+			}
+
+			std::vector<std::string> workedCalls;
+			std::vector<std::string> knownCalls;
+			suggester->update(evt.partialCall.value());
+			suggester->get(MAX_SUGGESTIONS, workedCalls, knownCalls);
+			ui.updateSuggestions(workedCalls, knownCalls, suggester->getCount());
+			break;
+		}
+
 		case UiEvt::EVT_SEND_TEXT:
 			xassert(evt.text, "Expecting text to send in event");
 
@@ -359,8 +472,15 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 				break;
 			}
 
+			if(!checkTxLock(focus)) {
+				ui.print("Text not sent");
+				break;
+			}
+
 			ui.print("Sending text: %s", evt.text.value().c_str());
-			keyer->send(evt.text.value());
+			if(!keyer->send(evt.text.value())) {
+				ui.print("Keyer queue full, text not sent");
+			}
 			break;
 
 		case UiEvt::EVT_WPM_UP:
@@ -395,14 +515,40 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 			keyer->abortSending();
 			break;
 
+		case UiEvt::EVT_SHOW_KEYER_STATS: {
+			if(!keyer) {
+				ui.print("Cannot show keyer statistics -- keyer support disabled");
+				break;
+			}
+
+			const std::vector<std::string> report(radio.getKeyerStats().getReport());
+			for(std::vector<std::string>::const_iterator i(report.begin()); i != report.end(); ++i) {
+				ui.print("%s", i->c_str());
+			}
+			break;
+		}
+
+		case UiEvt::EVT_SHOW_CAT_STATS: {
+			if(!cat) {
+				ui.print("CAT disabled");
+				break;
+			}
+
+			const std::vector<std::string> report(radio.getCatStats().getReport());
+			for(std::vector<std::string>::const_iterator i(report.begin()); i != report.end(); ++i) {
+				ui.print("%s", i->c_str());
+			}
+			break;
+		}
+
 		case UiEvt::EVT_ZERO_IN:
 			if(!cat) {
 				ui.print("CAT disabled");
 				break;
 			}
 
-			if(curFreq) {
-				ui.print("Zeroing in from %s", util::formatFreq(curFreq.value()).c_str());
+			if(radio.getFreq()) {
+				ui.print("Zeroing in from %s", util::formatFreq(radio.getFreq().value()).c_str());
 			}
 			else {
 				ui.print("Zeroing in");
@@ -419,117 +565,6 @@ bool CurseRadio::uiEvt(const UiEvt &evt)
 	return false;
 }
 
-void CurseRadio::catEvt(const CatEvt &evt)
-{
-	switch(evt.type) {
-		case CatEvt::EVT_ERROR:
-			xassert(evt.error, "Expected error field not found");
-			xthrow("CAT error: %s", evt.error.value().c_str());
-			break;
-
-		case CatEvt::EVT_METER:
-			xassert(evt.meter, "Expected meter field not found");
-
-			switch(evt.meter.value().first) {
-				case meters::METER_IDD:
-					if(!evt.meter.value().second) {
-						/* If IDD = 0, then we're in RX mode:
-						 * - read signal
-						 * - read freq
-						 * - read mode
-						 */
-						cat->getMeter(meters::METER_SIG);
-					}
-					else {
-						/* IDD != 0, we're in TX mode:
-						 * - store IDD
-						 * - read ALC
-						 * - read COMP
-						 * - read PWR
-						 * - read SWR
-						 */
-						schedMeters[evt.meter.value().first] = evt.meter.value().second;
-						cat->getMeter(meters::METER_ALC);
-					}
-					break;
-
-				case meters::METER_SIG:
-					schedMeters[evt.meter.value().first] = evt.meter.value().second;
-					cat->getFreq();
-					break;
-
-				case meters::METER_ALC:
-					schedMeters[evt.meter.value().first] = evt.meter.value().second;
-					cat->getMeter(meters::METER_COMP);
-					break;
-
-				case meters::METER_COMP:
-					schedMeters[evt.meter.value().first] = evt.meter.value().second;
-					cat->getMeter(meters::METER_PWR);
-					break;
-
-				case meters::METER_PWR:
-					schedMeters[evt.meter.value().first] = evt.meter.value().second;
-					cat->getMeter(meters::METER_SWR);
-					break;
-
-				case meters::METER_SWR:
-					schedMeters[evt.meter.value().first] = evt.meter.value().second;
-					ui.updateMeters(schedMeters, curFreq, curMode);
-					schedMeters.clear();
-					catMeterTimer->start();
-					break;
-
-				default:
-					xthrow("Unknown meter %d", evt.meter.value().first);
-					break;
-			}
-			break;
-
-		case CatEvt::EVT_FREQ:
-			xassert(evt.freq, "Expecting frequency in event");
-			curFreq = evt.freq;
-			broadcastFreq();
-			cat->getMode();
-			break;
-
-		case CatEvt::EVT_MODE:
-			xassert(evt.mode, "Expecting mode in event");
-			curMode = evt.mode;
-			broadcastMode();
-			ui.updateMeters(schedMeters, curFreq, curMode);
-			schedMeters.clear();
-			catMeterTimer->start();
-			break;
-
-		default:
-			xthrow("Unknown CAT event %d", evt.type);
-			break;
-	}
-}
-
-void CurseRadio::keyerEvt(const KeyerEvt &evt)
-{
-	xassert(ptt, "Keyer event without PTT, this shouldn't happen");
-
-	switch(evt.type) {
-		case KeyerEvt::EVT_NONE:
-			break;
-
-		case KeyerEvt::EVT_KEY_DOWN:
-			ptt->keyDown();
-			break;
-
-		case KeyerEvt::EVT_KEY_UP:
-			ptt->keyUp();
-			break;
-
-		default:
-			xthrow("Unknown keyer event %d", evt.type);
-			break;
-	}
-}
-
 int main(int argc, char *const argv[])
 {
 	try {
@@ -538,8 +573,19 @@ int main(int argc, char *const argv[])
 			return EXIT_SUCCESS;
 		}
 
-		CurseRadio cr;
-		cr.run(cli);
+		std::vector<std::string> report;
+		{
+			CurseRadio cr;
+			cr.run(cli);
+			report = cr.getReport();
+		}
+
+		/* Printed when the UI is already closed */
+		if(cli.getReport()) {
+			for(std::vector<std::string>::const_iterator i(report.begin()); i != report.end(); ++i) {
+				printf("%s\n", i->c_str());
+			}
+		}
 	}
 	catch(const std::runtime_error &e) {
 		fprintf(stderr, "Fatal error: %s\n", e.what());
@@ -1,46 +1,56 @@
 #pragma once
 
 #include <memory>
+#include <vector>
+#include <optional>
+#include <ctime>
 #include "cli.h"
 #include "ui.h"
 #include "exchange.h"
 #include "presets.h"
-#include "cat.h"
+#include "catreplayer.h"
 #include "timer.h"
-#include "ptt.h"
-#include "keyer.h"
+#include "radio.h"
+#include "rigserver.h"
 #include "logger.h"
-#include "mode.h"
-#include "meters.h"
+#include "scp.h"
+#include "callsuggester.h"
 #include "broadcaster.h"
+#include "reactor.h"
 
+/* Radios share the terminal, the logger and the exchange counter. UI
+ * commands go to the radio that has focus, and only one radio transmits at
+ * a time: sending is refused while any other radio transmits.
+ */
 class CurseRadio {
 public:
 	void run(const Cli &cli);
+	std::vector<std::string> getReport() const;
 
 private:
+	Reactor reactor;
 	Ui ui;
 	std::unique_ptr<Exchange> exchange;
 	std::unique_ptr<Presets> presets;
-	std::unique_ptr<Cat> cat;
-	std::unique_ptr<Timer> catTimeoutTimer;
-	std::unique_ptr<Timer> catMeterTimer;
-	std::unique_ptr<Ptt> ptt;
-	std::unique_ptr<Keyer> keyer;
+	std::unique_ptr<Timer> catReplayTimer;
+	std::unique_ptr<CatReplayer> catReplayer;
 	std::unique_ptr<Logger> logger;
+	std::unique_ptr<Scp> scp;
+	std::unique_ptr<CallSuggester> suggester;
 	std::unique_ptr<Broadcaster> bcast;
+	std::vector<std::unique_ptr<Radio> > radios;
+	size_t focus{0};                  /* Index of the radio that has focus */
+	std::unique_ptr<RigServer> rigServer;
 
-	std::optional<uint32_t> curFreq;  /* Current frequency, updated by CAT meter timer */
-	std::optional<Mode> curMode;      /* Current mode, updated by CAT meter timer */
 	std::optional<time_t> frozenTime; /* Time frozen by UI when 'l' is pressed */
 
-	/* Meters being read, scheduled for sending to UI */
-	std::map<meters::Meter, uint8_t> schedMeters;
-
 	/* Returns true if need to exit */
 	bool uiEvt(const UiEvt &evt);
-	void catEvt(const CatEvt &evt);
-	void keyerEvt(const KeyerEvt &evt);
-	void broadcastFreq();
-	void broadcastMode();
+
+	/* Returns false, with a message printed, if any radio other than the
+	 * given one transmits
+	 */
+	bool checkTxLock(size_t radio);
+
+	void checkKnownCalls(const std::string &part);
 };
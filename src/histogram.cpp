@@ -0,0 +1,84 @@
+#include <algorithm>
+#include "histogram.h"
+#include "throw.h"
+#include "util.h"
+
+Histogram::Histogram(const std::vector<int64_t> &bounds)
+    : bounds(bounds), bins(new std::atomic<uint64_t>[bounds.size() + 1])
+{
+	xassert(std::is_sorted(bounds.begin(), bounds.end()), "Histogram bounds not sorted");
+	for(size_t i(0); i <= bounds.size(); ++i) {
+		bins[i] = 0;
+	}
+}
+
+void Histogram::add(int64_t value)
+{
+	const size_t bin(std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin());
+	bins[bin].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(value, std::memory_order_relaxed);
+
+	int64_t cur(min.load(std::memory_order_relaxed));
+	while(value < cur && !min.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+	}
+
+	cur = max.load(std::memory_order_relaxed);
+	while(value > cur && !max.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+	}
+}
+
+uint64_t Histogram::getCount() const
+{
+	return count.load(std::memory_order_relaxed);
+}
+
+int64_t Histogram::getMin() const
+{
+	return getCount() ? min.load(std::memory_order_relaxed) : 0;
+}
+
+int64_t Histogram::getMax() const
+{
+	return getCount() ? max.load(std::memory_order_relaxed) : 0;
+}
+
+double Histogram::getAvg() const
+{
+	const uint64_t n(getCount());
+	return n ? (double) sum.load(std::memory_order_relaxed) / n : 0;
+}
+
+void Histogram::report(const std::string &name, const std::string &unit, std::vector<std::string> &rs) const
+{
+	if(!getCount()) {
+		return;
+	}
+
+	rs.push_back(util::format("  %s: %lu samples, avg %.0f %s, min %ld %s, max %ld %s",
+	    name.c_str(),
+	    (unsigned long) getCount(),
+	    getAvg(), unit.c_str(),
+	    (long) getMin(), unit.c_str(),
+	    (long) getMax(), unit.c_str()));
+
+	for(size_t i(0); i <= bounds.size(); ++i) {
+		const uint64_t n(bins[i].load(std::memory_order_relaxed));
+		if(!n) {
+			continue;
+		}
+
+		std::string range;
+		if(i == 0) {
+			range = util::format("<= %ld", (long) bounds[0]);
+		}
+		else if(i == bounds.size()) {
+			range = util::format("> %ld", (long) bounds[i - 1]);
+		}
+		else {
+			range = util::format("%ld .. %ld", (long) bounds[i - 1], (long) bounds[i]);
+		}
+
+		rs.push_back(util::format("%16s %s: %lu", range.c_str(), unit.c_str(), (unsigned long) n));
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+/* Histogram with fixed bins. Counters are atomic, so values can be added
+ * by one thread while another one reads them.
+ */
+class Histogram {
+public:
+	/* Bin i counts values v with bounds[i - 1] < v <= bounds[i]; the last
+	 * bin counts values above the last bound. Bounds must be ascending.
+	 */
+	Histogram(const std::vector<int64_t> &bounds);
+
+	void add(int64_t value);
+
+	uint64_t getCount() const;
+	int64_t getMin() const;
+	int64_t getMax() const;
+	double getAvg() const;
+
+	/* Appends a summary line and non-empty bins to rs, for statistics
+	 * reports; nothing if there are no samples
+	 */
+	void report(const std::string &name, const std::string &unit, std::vector<std::string> &rs) const;
+
+private:
+	const std::vector<int64_t> bounds;
+	std::unique_ptr<std::atomic<uint64_t>[]> bins;
+	std::atomic<uint64_t> count{0};
+	std::atomic<int64_t> sum{0};
+	std::atomic<int64_t> min{INT64_MAX};
+	std::atomic<int64_t> max{INT64_MIN};
+};
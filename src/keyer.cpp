@@ -1,84 +1,103 @@
-#include <map>
+#include <climits>
 #include "keyer.h"
+#include "keyerthread.h"
 #include "throw.h"
+#include "util.h"
 
-static const unsigned MAX_WPM = 100;
-
-Keyer::Keyer(unsigned defaultWpm)
-    : wpm(defaultWpm)
+Keyer::Keyer(unsigned defaultWpm, KeyerThread *thread)
+    : wpm(defaultWpm), thread(thread)
 {
 	xassert(wpm <= MAX_WPM, "Default WPM %u invalid", wpm);
 }
 
 int Keyer::getFd() const
 {
-	return timer.getFd();
+	return thread ? thread->getFd() : timer.getFd();
 }
 
 KeyerEvt Keyer::read()
 {
+	if(thread) {
+		thread->read();
+		return KeyerEvt::EVT_NONE;
+	}
+
 	if(!timer.read()) {
 		return KeyerEvt::EVT_NONE;
 	}
 
-	xassert(!pending.empty(), "Keyer event, but event not scheduled");
-	const KeyerEvt evt(pending[0].second);
-	pending.erase(pending.begin());
-	if(!pending.empty()) {
-		next();
+	/* Deadline of the current run reached, switch to the next one */
+	if(started) {
+		KeyerRun done;
+		pending.pop(done);
+		started = false;
 	}
 
+	const KeyerRun *run(pending.front());
+	if(!run) {
+		return KeyerEvt::EVT_NONE;
+	}
+
+	KeyerEvt evt(KeyerEvt::EVT_NONE);
+	if(run->keyDown != keyDown) {
+		keyDown  = run->keyDown;
+		evt.type = keyDown ? KeyerEvt::EVT_KEY_DOWN : KeyerEvt::EVT_KEY_UP;
+	}
+
+	started = true;
+	timeline.startRun(*run, wpm, util::monotonicNs(), evt);
+	timer.startAt(timeline.getDeadline());
 	return evt;
 }
 
 bool Keyer::isSending() const
 {
-	return !pending.empty();
+	return thread ? thread->isSending() : !pending.empty();
 }
 
-void Keyer::send(const std::string &s)
+bool Keyer::send(const std::string &s)
 {
 	xassert(!s.empty(), "Refusing to send empty string");
 
-	const bool sending = isSending();
-	const std::string morseString(stringToMorse(s));
-	for(std::string::const_iterator i(morseString.begin()); i != morseString.end(); ++i) {
-		switch(*i) {
-			case '-':
-				/* dash: key down, 3x dot time, key up, 1x dot time */
-				add(0, KeyerEvt::EVT_KEY_DOWN);
-				add(3, KeyerEvt::EVT_KEY_UP);
-				add(1, KeyerEvt::EVT_NONE);
-				break;
-
-			case '.':
-				/* dot: key down, 1x dot time, key up, 1x dot time */
-				add(0, KeyerEvt::EVT_KEY_DOWN);
-				add(1, KeyerEvt::EVT_KEY_UP);
-				add(1, KeyerEvt::EVT_NONE);
-				break;
-
-			case ' ':
-				/* inter-character space: 2x dot time (because 1x was from previous symbol) */
-				add(2, KeyerEvt::EVT_NONE);
-				break;
-
-			default:
-				xthrow("Invalid char %c in morse string", *i);
-				break;
-		}
+	size_t count;
+	if(!compile(s, scratch, MAX_RUNS, count)) {
+		return false;
+	}
+
+	if(!count) {
+		return true;
+	}
+
+	if(thread) {
+		return thread->send(scratch, count);
+	}
+
+	const bool sending(isSending());
+	if(!pending.push(scratch, count)) {
+		return false;
 	}
 
 	if(!sending) {
-		next();
+		timeline.restart(util::monotonicNs());
+		timer.startAt(timeline.getDeadline());
 	}
+
+	return true;
 }
 
 void Keyer::abortSending()
 {
+	if(thread) {
+		thread->abortSending();
+		return;
+	}
+
 	if(!pending.empty()) {
-		pending.clear();
-		add(0, KeyerEvt::EVT_KEY_UP);
+		pending.discard(pending.getTail());
+		started = false;
+		pending.push(KeyerRun{false, 0, 0});
+		timeline.restart(util::monotonicNs());
+		timer.startAt(timeline.getDeadline());
 	}
 }
 
@@ -87,6 +106,8 @@ unsigned Keyer::wpmUp()
 	if(wpm < MAX_WPM) {
 		++wpm;
 	}
+
+	changeWpm();
 	return wpm;
 }
 
@@ -95,89 +116,266 @@ unsigned Keyer::wpmDown()
 	if(wpm > 1) {
 		--wpm;
 	}
+
+	changeWpm();
 	return wpm;
 }
 
-void Keyer::next()
-{
-	xassert(!pending.empty(), "next() called on empty pending vector");
-	timer.start(pending[0].first * (1000 / (wpm * 50. / 60)));
-}
-
-void Keyer::add(unsigned msec, KeyerEvt evt)
-{
-	pending.push_back(std::pair<unsigned, KeyerEvt>(msec, evt));
-}
-
-static const std::map<char, std::string> charMap = {
-    {' ', " "},
-    {'a', ".-"},
-    {'b', "-..."},
-    {'c', "-.-."},
-    {'d', "-.."},
-    {'e', "."},
-    {'f', "..-."},
-    {'g', "--."},
-    {'h', "...."},
-    {'i', ".."},
-    {'j', ".---"},
-    {'k', "-.-"},
-    {'l', ".-.."},
-    {'m', "--"},
-    {'n', "-."},
-    {'o', "---"},
-    {'p', ".--."},
-    {'q', "--.-"},
-    {'r', ".-."},
-    {'s', "..."},
-    {'t', "-"},
-    {'u', "..-"},
-    {'v', "...-"},
-    {'w', ".--"},
-    {'x', "-..-"},
-    {'y', "-.--"},
-    {'z', "--.."},
-    {'1', ".----"},
-    {'2', "..---"},
-    {'3', "...--"},
-    {'4', "....-"},
-    {'5', "....."},
-    {'6', "-...."},
-    {'7', "--..."},
-    {'8', "---.."},
-    {'9', "----."},
-    {'0', "-----"},
-    {',', "..-.."},
-    {'.', ".-.-.-"},
-    {'?', "..--.."},
-    {';', "-.-.-"},
-    {':', "---..."},
-    {'/', "-..-."},
-    {'+', ".-.-."},
-    {'-', "-....-"},
-    {'=', "-...-"},
+void Keyer::changeWpm()
+{
+	if(thread) {
+		thread->setWpm(wpm);
+		return;
+	}
+
+	if(started && timeline.changeWpm(wpm, util::monotonicNs())) {
+		timer.startAt(timeline.getDeadline());
+	}
+}
+
+void KeyerTimeline::restart(uint64_t now)
+{
+	deadline = now;
+	++timeline;
+}
+
+void KeyerTimeline::startRun(const KeyerRun &run, unsigned wpm, uint64_t now, KeyerEvt &evt)
+{
+	runWpmOffset = run.wpmOffset;
+	runWpm       = getEffectiveWpm(wpm, run.wpmOffset);
+
+	evt.deadline = deadline;
+	evt.wpm      = runWpm;
+	evt.timeline = timeline;
+
+	const uint64_t duration(run.dots * getDotNs(runWpm));
+
+	/* If we're so late that the whole run has already elapsed (loop stalled
+	 * for longer than one element), start the timeline anew instead of
+	 * shrinking the run to nothing. Zero-length runs are always late by
+	 * definition, so they don't count.
+	 */
+	if(duration && deadline + duration < now) {
+		deadline = now;
+		++timeline;
+	}
+
+	deadline += duration;
+}
+
+bool KeyerTimeline::changeWpm(unsigned wpm, uint64_t now)
+{
+	const unsigned newWpm(getEffectiveWpm(wpm, runWpmOffset));
+	if(newWpm == runWpm) {
+		return false;
+	}
+
+	const unsigned oldWpm(runWpm);
+	runWpm = newWpm;
+	if(now >= deadline) {
+		return false;
+	}
+
+	/* Remaining time scales with the dot length, that is inversely with WPM */
+	deadline = now + (deadline - now) * oldWpm / newWpm;
+	return true;
+}
+
+uint64_t KeyerTimeline::getDeadline() const
+{
+	return deadline;
+}
+
+unsigned KeyerTimeline::getEffectiveWpm(unsigned wpm, int wpmOffset)
+{
+	const int rs(wpm + wpmOffset);
+	if(rs < 1) {
+		return 1;
+	}
+
+	if(rs > (int) Keyer::MAX_WPM) {
+		return Keyer::MAX_WPM;
+	}
+
+	return rs;
+}
+
+uint64_t KeyerTimeline::getDotNs(unsigned wpm)
+{
+	/* PARIS: 50 dot periods per word */
+	return 60000000000ULL / (wpm * 50);
+}
+
+/* Characters are packed into bitstreams: highest set bit is a start marker,
+ * bits below it are elements (0: dot, 1: dash), first element first. Code 0
+ * means that character is not supported, code 1 (just the marker) is used
+ * for space.
+ */
+static constexpr uint16_t pack(const char *s)
+{
+	uint16_t rs(1);
+	for(; *s; ++s) {
+		rs = (rs << 1) | (*s == '-');
+	}
+
+	return rs;
+}
+
+struct MorseTable {
+	uint16_t codes[128];
 };
 
-std::string Keyer::stringToMorse(const std::string &s)
+static constexpr MorseTable makeMorseTable()
+{
+	constexpr struct {
+		char ch;
+		const char *morse;
+	} chars[] = {
+	    {' ', ""},
+	    {'a', ".-"},
+	    {'b', "-..."},
+	    {'c', "-.-."},
+	    {'d', "-.."},
+	    {'e', "."},
+	    {'f', "..-."},
+	    {'g', "--."},
+	    {'h', "...."},
+	    {'i', ".."},
+	    {'j', ".---"},
+	    {'k', "-.-"},
+	    {'l', ".-.."},
+	    {'m', "--"},
+	    {'n', "-."},
+	    {'o', "---"},
+	    {'p', ".--."},
+	    {'q', "--.-"},
+	    {'r', ".-."},
+	    {'s', "..."},
+	    {'t', "-"},
+	    {'u', "..-"},
+	    {'v', "...-"},
+	    {'w', ".--"},
+	    {'x', "-..-"},
+	    {'y', "-.--"},
+	    {'z', "--.."},
+	    {'1', ".----"},
+	    {'2', "..---"},
+	    {'3', "...--"},
+	    {'4', "....-"},
+	    {'5', "....."},
+	    {'6', "-...."},
+	    {'7', "--..."},
+	    {'8', "---.."},
+	    {'9', "----."},
+	    {'0', "-----"},
+	    {',', "..-.."},
+	    {'.', ".-.-.-"},
+	    {'?', "..--.."},
+	    {';', "-.-.-"},
+	    {':', "---..."},
+	    {'/', "-..-."},
+	    {'+', ".-.-."},
+	    {'-', "-....-"},
+	    {'=', "-...-"},
+	};
+
+	MorseTable t{};
+	for(const auto &c : chars) {
+		t.codes[(unsigned char) c.ch] = pack(c.morse);
+		if(c.ch >= 'a' && c.ch <= 'z') {
+			t.codes[(unsigned char) (c.ch - 'a' + 'A')] = pack(c.morse);
+		}
+	}
+
+	return t;
+}
+
+static constexpr MorseTable morseTable = makeMorseTable();
+
+static_assert(morseTable.codes[(unsigned char) 'A'] == 0x5, "Invalid Morse table");
+static_assert(morseTable.codes[(unsigned char) ' '] == 0x1, "Invalid Morse table");
+static_assert(morseTable.codes[(unsigned char) '#'] == 0x0, "Invalid Morse table");
+
+static uint16_t lookup(char ch)
+{
+	const unsigned char uch(ch);
+	return (uch < 128) ? morseTable.codes[uch] : 0;
+}
+
+/* Appends a run, merging it with the previous one if possible */
+static bool addRun(KeyerRun *runs, size_t &count, size_t maxRuns, bool keyDown, int8_t wpmOffset, uint16_t dots)
+{
+	KeyerRun *prev(count ? &runs[count - 1] : nullptr);
+	if(prev && prev->keyDown == keyDown && prev->wpmOffset == wpmOffset && prev->dots <= UINT16_MAX - dots) {
+		prev->dots += dots;
+		return true;
+	}
+
+	if(count == maxRuns) {
+		return false;
+	}
+
+	runs[count++] = KeyerRun{keyDown, wpmOffset, dots};
+	return true;
+}
+
+bool Keyer::compile(const std::string &s, KeyerRun *runs, size_t maxRuns, size_t &count)
 {
-	std::string rs;
+	count = 0;
+	bool first(true);
+	int8_t wpmOffset(0);
 	for(std::string::const_iterator i(s.begin()); i != s.end(); ++i) {
-		const std::map<char, std::string>::const_iterator it(charMap.find(tolower(*i)));
-		if(it == charMap.end()) {
+		/* Speed escapes apply until the end of the message */
+		if(*i == WPM_ESC_UP || *i == WPM_ESC_DOWN) {
+			const int newOffset(wpmOffset + ((*i == WPM_ESC_UP) ? WPM_ESC_STEP : -WPM_ESC_STEP));
+			if(newOffset >= -(int) MAX_WPM && newOffset <= (int) MAX_WPM) {
+				wpmOffset = newOffset;
+			}
+
+			continue;
+		}
+
+		const uint16_t code(lookup(*i));
+		if(!code) {
+			continue;
+		}
+
+		/* Inter-character space: 2x dot time (because 1x was from previous
+		 * element); space character is this plus one more inter-character
+		 * space, 7x dot time in total
+		 */
+		if(!first && !addRun(runs, count, maxRuns, false, wpmOffset, 2)) {
+			return false;
+		}
+
+		first = false;
+		if(code == 1) {
+			if(!addRun(runs, count, maxRuns, false, wpmOffset, 2)) {
+				return false;
+			}
+
 			continue;
 		}
 
-		if(!rs.empty()) {
-			rs += " ";
+		int bit(15);
+		while(!(code & (1 << bit))) {
+			--bit;
 		}
 
-		rs += it->second;
+		/* Dash: key down for 3x dot time, dot: key down for 1x dot time;
+		 * both followed by key up for 1x dot time
+		 */
+		for(--bit; bit >= 0; --bit) {
+			if(!addRun(runs, count, maxRuns, true, wpmOffset, (code & (1 << bit)) ? 3 : 1) || !addRun(runs, count, maxRuns, false, wpmOffset, 1)) {
+				return false;
+			}
+		}
 	}
 
-	return rs;
+	return true;
 }
 
 bool Keyer::isCharAllowed(char ch)
 {
-	return charMap.find(tolower(ch)) != charMap.end();
+	return lookup(ch) != 0 || ch == WPM_ESC_UP || ch == WPM_ESC_DOWN;
 }
@@ -1,9 +1,9 @@
 #pragma once
 
-#include <vector>
-#include <utility>
 #include <string>
+#include <cstdint>
 #include "timer.h"
+#include "ringbuffer.h"
 
 struct KeyerEvt {
 	enum EvtType {
@@ -12,36 +12,105 @@ struct KeyerEvt {
 		EVT_KEY_UP,
 	} type;
 
+	/* Set by Keyer::read(), used for statistics (see KeyerStats) */
+	uint64_t deadline{0};
+	unsigned wpm{0};
+	uint32_t timeline{0};
+
 	KeyerEvt(EvtType type)
 	    : type(type) {}
 };
 
+/* Key state held for a number of dot periods. Messages are compiled into
+ * sequences of these; consecutive periods with the same key state and
+ * speed are merged. Speed is relative to the keyer speed set by the
+ * operator, so it can be changed with speed escapes in the text, and
+ * the keyer speed can be changed while sending.
+ */
+struct KeyerRun {
+	bool keyDown;
+	int8_t wpmOffset;
+	uint16_t dots;
+};
+
+/* Timing of runs, shared by Keyer and KeyerThread. Deadline of a run is
+ * derived from the deadline of the previous run, not from the time the run
+ * was actually started, so dispatch latency doesn't accumulate.
+ */
+class KeyerTimeline {
+public:
+	/* Next run will be started now, as a new timeline */
+	void restart(uint64_t now);
+
+	/* Starts run at the current deadline; evt gets scheduled time of the
+	 * run start (see KeyerEvt)
+	 */
+	void startRun(const KeyerRun &run, unsigned wpm, uint64_t now, KeyerEvt &evt);
+
+	/* Rederives the deadline of the current run from the part that's left,
+	 * if effective speed changed. Returns true if deadline changed.
+	 */
+	bool changeWpm(unsigned wpm, uint64_t now);
+
+	uint64_t getDeadline() const;
+
+	static unsigned getEffectiveWpm(unsigned wpm, int wpmOffset);
+	static uint64_t getDotNs(unsigned wpm);
+
+private:
+	uint64_t deadline{0};
+	int8_t runWpmOffset{0};
+	unsigned runWpm{0};
+
+	/* Incremented whenever the timeline is started anew */
+	uint32_t timeline{0};
+};
+
+class KeyerThread;
+
 class Keyer {
 public:
-	Keyer(unsigned defaultWpm);
+	static const unsigned MAX_WPM  = 100;
+	static const size_t MAX_RUNS   = 16384;
+	static const int WPM_ESC_STEP  = 2;
+	static const char WPM_ESC_UP   = '>';
+	static const char WPM_ESC_DOWN = '<';
+
+	/* If thread is set, messages are keyed by it, and this class only
+	 * translates them; otherwise they're timed here and keying events
+	 * are returned by read()
+	 */
+	Keyer(unsigned defaultWpm, KeyerThread *thread = nullptr);
 
 	int getFd() const;
 	KeyerEvt read();
 
 	bool isSending() const;
-	void send(const std::string &s);
+	bool send(const std::string &s);
 	void abortSending();
 	unsigned wpmUp();
 	unsigned wpmDown();
 
 	static bool isCharAllowed(char ch);
 
+	/* Returns false if message doesn't fit in maxRuns */
+	static bool compile(const std::string &s, KeyerRun *runs, size_t maxRuns, size_t &count);
+
 private:
 	unsigned wpm;
+	KeyerThread *thread;
 	Timer timer;
 
-	/* First in pair: number of dot periods to wait
-	 * Second in pair: event to generate after this period
-	 */
-	std::vector<std::pair<unsigned, KeyerEvt> > pending;
+	/* Front run is the one being keyed now (if started) */
+	RingBuffer<KeyerRun, MAX_RUNS> pending;
+	bool started{false};
+	bool keyDown{false};
+
+	/* Message is compiled here before it's queued */
+	KeyerRun scratch[MAX_RUNS];
 
-	void add(unsigned msec, KeyerEvt evt);
-	void next();
+	/* Timer is armed for the deadline of the front run */
+	KeyerTimeline timeline;
 
-	static std::string stringToMorse(const std::string &s);
+	void changeWpm();
 };
@@ -0,0 +1,53 @@
+#include "keyerstats.h"
+#include "throw.h"
+#include "util.h"
+
+/* In microseconds */
+static const std::vector<int64_t> bounds = {
+    -5000, -2000, -1000, -500, -200, -100, -50, -20, -10, 0,
+    10, 20, 50, 100, 200, 500, 1000, 2000, 5000};
+
+KeyerStats::KeyerStats()
+{
+	for(unsigned i(0); i <= Keyer::MAX_WPM; ++i) {
+		edgeError[i].reset(new Histogram(bounds));
+		lengthError[i].reset(new Histogram(bounds));
+	}
+}
+
+void KeyerStats::edge(unsigned wpm, uint32_t timeline, uint64_t scheduled, uint64_t actual)
+{
+	xassert(wpm <= Keyer::MAX_WPM, "WPM %u out of range", wpm);
+
+	edgeError[wpm]->add(((int64_t) actual - (int64_t) scheduled) / 1000);
+	if(havePrev && prevTimeline == timeline) {
+		const int64_t scheduledLength(scheduled - prevScheduled);
+		const int64_t actualLength(actual - prevActual);
+		lengthError[wpm]->add((actualLength - scheduledLength) / 1000);
+	}
+
+	havePrev      = true;
+	prevTimeline  = timeline;
+	prevScheduled = scheduled;
+	prevActual    = actual;
+}
+
+std::vector<std::string> KeyerStats::getReport() const
+{
+	std::vector<std::string> rs;
+	for(unsigned i(0); i <= Keyer::MAX_WPM; ++i) {
+		if(!edgeError[i]->getCount()) {
+			continue;
+		}
+
+		rs.push_back(util::format("Keyer timing at %u WPM:", i));
+		edgeError[i]->report("Edge error (actual - scheduled)", "us", rs);
+		lengthError[i]->report("Element length error (actual - scheduled)", "us", rs);
+	}
+
+	if(rs.empty()) {
+		rs.push_back("Keyer timing: nothing keyed yet");
+	}
+
+	return rs;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "histogram.h"
+#include "keyer.h"
+
+/* Keying accuracy statistics: error of each PTT edge (actual time vs.
+ * scheduled time) and error of each element length (time between edges),
+ * kept separately for every speed. Edges are added by one thread (main
+ * loop or keyer thread), report can be made by another one.
+ */
+class KeyerStats {
+public:
+	KeyerStats();
+
+	/* Edges are timestamped with util::monotonicNs(). Timeline identifies
+	 * a continuous keying sequence; element length is only measured
+	 * between edges of the same timeline.
+	 */
+	void edge(unsigned wpm, uint32_t timeline, uint64_t scheduled, uint64_t actual);
+
+	std::vector<std::string> getReport() const;
+
+private:
+	std::unique_ptr<Histogram> edgeError[Keyer::MAX_WPM + 1];
+	std::unique_ptr<Histogram> lengthError[Keyer::MAX_WPM + 1];
+
+	bool havePrev{false};
+	uint32_t prevTimeline{0};
+	uint64_t prevScheduled{0};
+	uint64_t prevActual{0};
+};
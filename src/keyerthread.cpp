@@ -0,0 +1,215 @@
+#include <stdexcept>
+#include <climits>
+#include <cerrno>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "keyerthread.h"
+#include "throw.h"
+#include "util.h"
+
+static const size_t NO_ABORT = SIZE_MAX;
+
+KeyerThread::KeyerThread(std::unique_ptr<Ptt> ptt, unsigned wpm, KeyerStats *stats)
+    : ptt(std::move(ptt)),
+      stats(stats),
+      errorFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      wpm(wpm),
+      abortPos(NO_ABORT)
+{
+	xassert(this->ptt, "PTT not set");
+	xassert(stats, "stats is nullptr");
+	xassert(errorFd != -1, "Could not create eventfd: %m");
+
+	thread = std::thread(&KeyerThread::threadFunc, this);
+
+	sched_param param{};
+	param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 1;
+	realtime             = pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param) == 0;
+
+	/* Only current pages; MCL_FUTURE could make later allocations fail
+	 * if RLIMIT_MEMLOCK is low
+	 */
+	memoryLocked = mlockall(MCL_CURRENT) == 0;
+}
+
+KeyerThread::~KeyerThread()
+{
+	quit = true;
+	wake();
+	thread.join();
+}
+
+bool KeyerThread::isRealtime() const
+{
+	return realtime;
+}
+
+bool KeyerThread::isMemoryLocked() const
+{
+	return memoryLocked;
+}
+
+int KeyerThread::getFd() const
+{
+	return errorFd;
+}
+
+void KeyerThread::read()
+{
+	uint64_t value;
+	if(::read(errorFd, &value, sizeof(value)) != sizeof(value) || !failed) {
+		return;
+	}
+
+	xthrow("Keyer thread failed: %s", error.c_str());
+}
+
+bool KeyerThread::send(const KeyerRun *runs, size_t count)
+{
+	if(!queue.push(runs, count)) {
+		return false;
+	}
+
+	wake();
+	return true;
+}
+
+bool KeyerThread::isSending() const
+{
+	return active || !queue.empty();
+}
+
+void KeyerThread::abortSending()
+{
+	abortPos = queue.getTail();
+	wake();
+}
+
+void KeyerThread::setWpm(unsigned wpm_)
+{
+	wpm = wpm_;
+	wake();
+}
+
+void KeyerThread::wake()
+{
+	wakeSeq.fetch_add(1, std::memory_order_release);
+	syscall(SYS_futex, &wakeSeq, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+void KeyerThread::sleep(uint32_t seq, const uint64_t *deadline)
+{
+	/* FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC timeout. It's used
+	 * instead of clock_nanosleep(), because it can be woken up without
+	 * races if the main thread aborts or queues something meanwhile
+	 */
+	timespec ts;
+	if(deadline) {
+		ts.tv_sec  = *deadline / 1000000000ULL;
+		ts.tv_nsec = *deadline % 1000000000ULL;
+	}
+
+	syscall(SYS_futex, &wakeSeq, FUTEX_WAIT_BITSET_PRIVATE, seq, deadline ? &ts : nullptr, nullptr, FUTEX_BITSET_MATCH_ANY);
+}
+
+void KeyerThread::threadFunc()
+{
+	try {
+		run();
+	}
+	catch(const std::runtime_error &e) {
+		error  = e.what();
+		failed = true;
+
+		const uint64_t value(1);
+		if(write(errorFd, &value, sizeof(value)) != sizeof(value)) {
+			/* Nothing more can be done here */
+		}
+	}
+}
+
+void KeyerThread::run()
+{
+	bool haveRun(false);
+	bool idle(true);
+	bool keyDown(false);
+	KeyerTimeline timeline;
+
+	for(;;) {
+		const uint32_t seq(wakeSeq.load(std::memory_order_acquire));
+		if(quit) {
+			break;
+		}
+
+		const size_t abortAt(abortPos.exchange(NO_ABORT));
+		if(abortAt != NO_ABORT) {
+			queue.discard(abortAt);
+			haveRun = false;
+			idle    = true;
+			if(keyDown) {
+				keyDown = false;
+				ptt->keyUp();
+			}
+		}
+
+		/* Keep the current run until its deadline, which changes if speed
+		 * is changed meanwhile
+		 */
+		if(haveRun) {
+			const uint64_t now(util::monotonicNs());
+			timeline.changeWpm(wpm, now);
+
+			const uint64_t deadline(timeline.getDeadline());
+			if(now < deadline) {
+				sleep(seq, &deadline);
+				continue;
+			}
+
+			haveRun = false;
+		}
+
+		active = true;
+		KeyerRun run;
+		if(!queue.pop(run)) {
+			active = false;
+			idle   = true;
+			sleep(seq, nullptr);
+			continue;
+		}
+
+		/* Same rules as in Keyer::send() and Keyer::read() */
+		if(idle) {
+			idle = false;
+			timeline.restart(util::monotonicNs());
+		}
+
+		KeyerEvt evt(KeyerEvt::EVT_NONE);
+		if(run.keyDown != keyDown) {
+			keyDown = run.keyDown;
+			if(keyDown) {
+				ptt->keyDown();
+			}
+			else {
+				ptt->keyUp();
+			}
+
+			evt.type = keyDown ? KeyerEvt::EVT_KEY_DOWN : KeyerEvt::EVT_KEY_UP;
+		}
+
+		const uint64_t now(util::monotonicNs());
+		timeline.startRun(run, wpm, now, evt);
+		if(evt.type != KeyerEvt::EVT_NONE) {
+			stats->edge(evt.wpm, evt.timeline, evt.deadline, now);
+		}
+
+		haveRun = true;
+	}
+
+	ptt->keyUp();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <string>
+#include "keyer.h"
+#include "keyerstats.h"
+#include "ptt.h"
+#include "fd.h"
+#include "ringbuffer.h"
+
+/* Keying engine running on its own thread. It owns the PTT port and keys
+ * it directly, sleeping until absolute CLOCK_MONOTONIC deadlines, so CW
+ * timing doesn't depend on how busy the main loop is. Messages are passed
+ * from the main loop through a lock-free queue.
+ *
+ * The thread is made SCHED_FIFO and the process memory is locked if it's
+ * permitted; if not, it works as a normal thread.
+ */
+class KeyerThread {
+public:
+	KeyerThread(std::unique_ptr<Ptt> ptt, unsigned wpm, KeyerStats *stats);
+	~KeyerThread();
+
+	bool isRealtime() const;
+	bool isMemoryLocked() const;
+
+	/* Becomes readable if the thread failed; read() throws then */
+	int getFd() const;
+	void read();
+
+	bool send(const KeyerRun *runs, size_t count);
+	bool isSending() const;
+	void abortSending();
+	void setWpm(unsigned wpm);
+
+private:
+	std::unique_ptr<Ptt> ptt;
+	KeyerStats *stats;
+	RingBuffer<KeyerRun, Keyer::MAX_RUNS> queue;
+	Fd errorFd;
+	bool realtime{false};
+	bool memoryLocked{false};
+
+	/* Bumped by the main thread whenever the keying thread should
+	 * reevaluate its state; the keying thread sleeps on it (futex)
+	 */
+	std::atomic<uint32_t> wakeSeq{0};
+	std::atomic<unsigned> wpm;
+	std::atomic<bool> active{false};
+	std::atomic<bool> quit{false};
+	std::atomic<size_t> abortPos;
+	std::atomic<bool> failed{false};
+	std::string error;
+
+	std::thread thread;
+
+	void wake();
+	void sleep(uint32_t seq, const uint64_t *deadline);
+	void threadFunc();
+	void run();
+};
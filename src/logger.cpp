@@ -1,14 +1,132 @@
 #include <ctime>
 #include <map>
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/stat.h>
 #include "logger.h"
 #include "file.h"
 #include "util.h"
 #include "throw.h"
 
-Logger::Logger(const std::string &call, const std::string &cbrFile)
-    : call(call), cbrFile(cbrFile)
+/* Amateur bands, for dupe checking. These are the widest edges of all
+ * regions, not the tuning ranges of the radio (see band.cpp). Cabrillo
+ * frequency field is in kHz, or it's a designator of a band from 6 m up,
+ * like 50, 144 or 1.2G.
+ */
+static const struct {
+	const char *name;
+	unsigned long minKhz;
+	unsigned long maxKhz;
+	const char *designator; /* Null if only given in kHz */
+} DUPE_BANDS[] = {
+    {"2200m", 135, 138, nullptr},
+    {"630m", 472, 479, nullptr},
+    {"160m", 1800, 2000, nullptr},
+    {"80m", 3500, 4000, nullptr},
+    {"60m", 5250, 5450, nullptr},
+    {"40m", 7000, 7300, nullptr},
+    {"30m", 10100, 10150, nullptr},
+    {"20m", 14000, 14350, nullptr},
+    {"17m", 18068, 18168, nullptr},
+    {"15m", 21000, 21450, nullptr},
+    {"12m", 24890, 24990, nullptr},
+    {"10m", 28000, 29700, nullptr},
+    {"6m", 50000, 54000, "50"},
+    {"4m", 70000, 70500, "70"},
+    {"2m", 144000, 148000, "144"},
+    {"1.25m", 222000, 225000, "222"},
+    {"70cm", 420000, 450000, "432"},
+    {"33cm", 902000, 928000, "902"},
+    {"23cm", 1240000, 1300000, "1.2G"},
+};
+
+static const std::map<Mode, std::string> cbrModes = {
+    {MODE_SSB_1, "PH"},
+    {MODE_SSB_2, "PH"},
+    {MODE_CW_1, "CW"},
+    {MODE_CW_2, "CW"},
+    {MODE_DATA_1, "DG"},
+    {MODE_DATA_2, "DG"},
+    {MODE_FM, "FM"},
+    {MODE_FM_N, "FM"},
+    // TODO: MODE_AM unsupported here
+};
+
+/* Frequency field outside every band is a band of its own */
+static std::string getBandKey(const std::string &freq)
+{
+	for(size_t i(0); i < sizeof(DUPE_BANDS) / sizeof(DUPE_BANDS[0]); ++i) {
+		if(DUPE_BANDS[i].designator && freq == DUPE_BANDS[i].designator) {
+			return DUPE_BANDS[i].name;
+		}
+	}
+
+	const unsigned long khz(strtoul(freq.c_str(), nullptr, 10));
+	for(size_t i(0); i < sizeof(DUPE_BANDS) / sizeof(DUPE_BANDS[0]); ++i) {
+		if(khz >= DUPE_BANDS[i].minKhz && khz <= DUPE_BANDS[i].maxKhz) {
+			return DUPE_BANDS[i].name;
+		}
+	}
+
+	return freq;
+}
+
+/* Phone and digital modes are all the same for dupe checking */
+static std::string getModeClass(const std::string &cbrMode)
+{
+	if(cbrMode == "PH" || cbrMode == "FM" || cbrMode == "AM") {
+		return "PH";
+	}
+
+	if(cbrMode == "RY") {
+		return "DG";
+	}
+
+	return cbrMode;
+}
+
+DupeRule parseDupeRule(const std::string &s)
+{
+	if(s.empty() || s == "call") {
+		return DUPE_CALL;
+	}
+
+	if(s == "band") {
+		return DUPE_BAND;
+	}
+
+	if(s == "bandmode") {
+		return DUPE_BAND_MODE;
+	}
+
+	xthrow("Unknown dupe rule: %s", s.c_str());
+	/* NOTREACHED */
+	return DUPE_CALL;
+}
+
+const char *getDupeRuleScope(DupeRule rule)
 {
+	switch(rule) {
+		case DUPE_CALL:
+			return "in this contest";
+
+		case DUPE_BAND:
+			return "on this band";
+
+		case DUPE_BAND_MODE:
+			return "on this band and mode";
+	}
+
+	xthrow("Unknown dupe rule %d", rule);
+	/* NOTREACHED */
+	return nullptr;
+}
+
+Logger::Logger(const std::string &call, const std::string &cbrFile, DupeRule dupeRule)
+    : call(call), cbrFile(cbrFile), dupeRule(dupeRule)
+{
+	refresh();
 }
 
 std::string Logger::log(const Entry &e)
@@ -18,20 +136,8 @@ std::string Logger::log(const Entry &e)
 	char datetime[64];
 	strftime(datetime, sizeof(datetime), "%Y-%m-%d %H%M", &tm);
 
-	static const std::map<Mode, std::string> modeMap = {
-	    {MODE_SSB_1, "PH"},
-	    {MODE_SSB_2, "PH"},
-	    {MODE_CW_1, "CW"},
-	    {MODE_CW_2, "CW"},
-	    {MODE_DATA_1, "DG"},
-	    {MODE_DATA_2, "DG"},
-	    {MODE_FM, "FM"},
-	    {MODE_FM_N, "FM"},
-	    // TODO: MODE_AM unsupported here
-	};
-
-	const std::map<Mode, std::string>::const_iterator i(modeMap.find(e.mode));
-	xassert(i != modeMap.end(), "Mode %d unsupported by Cabrillo", e.mode);
+	const std::map<Mode, std::string>::const_iterator i(cbrModes.find(e.mode));
+	xassert(i != cbrModes.end(), "Mode %d unsupported by Cabrillo", e.mode);
 
 	const std::string s(util::format("QSO: %u %s %s %s %s %s %s %s %s",
 	    e.freq / 1000,
@@ -44,49 +150,212 @@ std::string Logger::log(const Entry &e)
 	    util::toUpper(e.rcvdRst).c_str(),
 	    util::toUpper(e.rcvdXchg).c_str()));
 
-	const File fp(fopen(cbrFile.c_str(), "a"));
-	xassert(fp, "Could not open Cabrillo file %s", cbrFile.c_str());
-	fprintf(fp, "%s\n", s.c_str());
+	{
+		const File fp(fopen(cbrFile.c_str(), "a"));
+		xassert(fp, "Could not open Cabrillo file %s", cbrFile.c_str());
+		fprintf(fp, "%s\n", s.c_str());
+	}
+
+	/* File just grew, so it's parsed from where it ended */
+	refresh();
 	return s;
 }
 
-bool Logger::checkIfExists(Ui *ui, const std::string &call, bool exactMatch) const
+bool Logger::checkIfExists(Ui *ui, const std::string &call, bool exactMatch)
 {
-	const File fp(fopen(cbrFile.c_str(), "r"));
-	if(!fp) {
+	refresh();
+	if(!fileState.exists) {
 		if(ui) {
 			ui->print("Callsign %s not in log -- logfile not found", call.c_str());
 		}
 		return false;
 	}
 
-	bool found = false;
-	for(;;) {
-		char buf[1024];
-		fgets(buf, sizeof(buf), fp);
-		xassert(!ferror(fp), "Error reading log file: %m");
-		if(feof(fp)) {
+	const std::string ucCall(util::toUpper(call));
+	std::vector<size_t> found;
+	if(exactMatch) {
+		const std::unordered_map<std::string, std::vector<size_t> >::const_iterator i(callIndex.find(ucCall));
+		if(i != callIndex.end()) {
+			found = i->second;
+		}
+	}
+	else {
+		for(std::unordered_map<std::string, std::vector<size_t> >::const_iterator i(callIndex.begin()); i != callIndex.end(); ++i) {
+			if(i->first.find(ucCall) != std::string::npos) {
+				found.insert(found.end(), i->second.begin(), i->second.end());
+			}
+		}
+
+		/* In the order of the log */
+		std::sort(found.begin(), found.end());
+	}
+
+	if(ui) {
+		for(std::vector<size_t>::const_iterator i(found.begin()); i != found.end(); ++i) {
+			ui->print("Call %s found: %s", call.c_str(), qsos[*i].c_str());
+		}
+
+		if(found.empty()) {
+			ui->print("Callsign %s not in log", call.c_str());
+		}
+	}
+
+	return !found.empty();
+}
+
+void Logger::getCalls(std::vector<std::string> &calls)
+{
+	refresh();
+
+	if(sortedCalls.size() != callIndex.size()) {
+		sortedCalls.clear();
+		sortedCalls.reserve(callIndex.size());
+		for(std::unordered_map<std::string, std::vector<size_t> >::const_iterator i(callIndex.begin()); i != callIndex.end(); ++i) {
+			sortedCalls.push_back(i->first);
+		}
+
+		std::sort(sortedCalls.begin(), sortedCalls.end());
+	}
+
+	calls = sortedCalls;
+}
+
+DupeRule Logger::getDupeRule() const
+{
+	return dupeRule;
+}
+
+bool Logger::isDupe(const std::string &call, uint32_t freq, Mode mode)
+{
+	refresh();
+
+	/* Only AM isn't there, and it's a phone mode */
+	const std::map<Mode, std::string>::const_iterator i(cbrModes.find(mode));
+	return dupeIndex.find(getDupeKey(util::toUpper(call), util::format("%u", freq / 1000), i != cbrModes.end() ? i->second : "AM")) != dupeIndex.end();
+}
+
+std::string Logger::getDupeKey(const std::string &call, const std::string &freq, const std::string &mode) const
+{
+	std::string key(call);
+	if(dupeRule == DUPE_BAND || dupeRule == DUPE_BAND_MODE) {
+		key += ' ';
+		key += getBandKey(freq);
+	}
+
+	if(dupeRule == DUPE_BAND_MODE) {
+		key += ' ';
+		key += getModeClass(mode);
+	}
+
+	return key;
+}
+
+Logger::FileState Logger::getFileState() const
+{
+	FileState rs;
+	struct stat st;
+	if(stat(cbrFile.c_str(), &st) == 0) {
+		rs.exists = true;
+		rs.dev    = st.st_dev;
+		rs.ino    = st.st_ino;
+		rs.size   = st.st_size;
+		rs.mtime  = st.st_mtim;
+	}
+
+	return rs;
+}
+
+void Logger::refresh()
+{
+	const FileState state(getFileState());
+	if(state.exists == fileState.exists && state.dev == fileState.dev && state.ino == fileState.ino && state.size == fileState.size &&
+	    state.mtime.tv_sec == fileState.mtime.tv_sec && state.mtime.tv_nsec == fileState.mtime.tv_nsec) {
+		return;
+	}
+
+	const File fp(state.exists ? fopen(cbrFile.c_str(), "r") : nullptr);
+
+	/* If the file only grew, what's already parsed stays, and only new lines
+	 * are parsed. Anything else (file replaced, truncated, rewritten with the
+	 * same size, or part that's already parsed changed) needs the whole file
+	 * to be parsed again.
+	 */
+	const bool grew(fp && fileState.exists && state.dev == fileState.dev && state.ino == fileState.ino && state.size > parsedSize &&
+	    getFingerprint(fp, parsedSize) == parsedFingerprint);
+	if(!grew) {
+		qsos.clear();
+		callIndex.clear();
+		sortedCalls.clear();
+		dupeIndex.clear();
+		parsedSize = 0;
+	}
+
+	fileState = state;
+	if(!fp) {
+		fileState.exists = false;
+		parsedFingerprint = getFingerprint(nullptr, 0);
+		return;
+	}
+
+	xassert(fseeko(fp, parsedSize, SEEK_SET) == 0, "Could not seek in log file: %m");
+
+	char *buf(nullptr);
+	size_t bufSize(0);
+	ssize_t len;
+	while((len = getline(&buf, &bufSize, fp)) > 0) {
+		/* Line that's being written now is parsed when it's complete */
+		if(buf[len - 1] != '\n') {
 			break;
 		}
 
+		parsedSize += len;
 		buf[strcspn(buf, "\n")] = 0;
 		buf[strcspn(buf, "\r")] = 0;
+		addLine(buf);
+	}
 
-		const std::vector<std::string> tok(util::tokenize(util::toUpper(buf), " ", 0));
-		if(tok.size() == 11 && tok[0] == "QSO:" && (exactMatch ? (tok[8] == util::toUpper(call)) : (tok[8].find(util::toUpper(call)) != std::string::npos))) {
-			if(ui) {
-				ui->print("Call %s found: %s", call.c_str(), buf);
-				found = true;
-			}
-			else {
-				return true;
-			}
-		}
+	const bool error(ferror(fp));
+	free(buf);
+	xassert(!error, "Error reading log file: %m");
+
+	parsedFingerprint = getFingerprint(fp, parsedSize);
+}
+
+uint64_t Logger::getFingerprint(FILE *fp, off_t size)
+{
+	/* FNV-1a of the beginning (header and first QSOs) and of the end (last
+	 * QSOs, most likely to be edited) of what's been parsed. Reading it all
+	 * would make every check cost as much as parsing the whole file.
+	 */
+	uint64_t hash(14695981039346656037ULL);
+	if(!fp || !size) {
+		return hash;
 	}
 
-	if(!found && ui) {
-		ui->print("Callsign %s not in log", call.c_str());
+	char buf[FINGERPRINT_BLOCK];
+	const off_t offsets[] = {0, size > FINGERPRINT_BLOCK ? size - FINGERPRINT_BLOCK : 0};
+	for(size_t i(0); i < sizeof(offsets) / sizeof(offsets[0]); ++i) {
+		const size_t len(std::min<off_t>(size, FINGERPRINT_BLOCK));
+		if(fseeko(fp, offsets[i], SEEK_SET) != 0 || fread(buf, 1, len, fp) != len) {
+			/* Can't be read, so it must have changed */
+			return 0;
+		}
+
+		for(size_t j(0); j < len; ++j) {
+			hash ^= (unsigned char) buf[j];
+			hash *= 1099511628211ULL;
+		}
 	}
 
-	return found;
+	return hash;
+}
+
+void Logger::addLine(const std::string &line)
+{
+	const std::vector<std::string> tok(util::tokenize(util::toUpper(line), " ", 0));
+	if(tok.size() == 11 && tok[0] == "QSO:") {
+		callIndex[tok[8]].push_back(qsos.size());
+		dupeIndex.insert(getDupeKey(tok[8], tok[1], tok[2]));
+		qsos.push_back(line);
+	}
 }
@@ -1,11 +1,42 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <ctime>
 #include <cstdint>
+#include <cstdio>
+#include <sys/types.h>
 #include "mode.h"
 #include "ui.h"
 
+/* What makes a QSO a dupe: the same callsign worked before in the contest,
+ * on the same band, or on the same band and in the same mode class (CW,
+ * phone, digital)
+ */
+enum DupeRule {
+	DUPE_CALL,
+	DUPE_BAND,
+	DUPE_BAND_MODE,
+};
+
+/* Parses CLI name of the rule: call, band or bandmode */
+DupeRule parseDupeRule(const std::string &s);
+
+/* Scope of the rule, for messages, like "on this band" */
+const char *getDupeRuleScope(DupeRule rule);
+
+/* QSOs of the Cabrillo file are kept in memory, indexed by callsign, so
+ * checking for dupes doesn't need to read the file. The file can still be
+ * edited externally: its size, modification time and inode are checked
+ * before every lookup, and if they changed, the file is read again. If it
+ * only grew (QSOs appended by us or by someone else), only the new part is
+ * read; parsed part is recognized by its size and fingerprint.
+ *
+ * Besides, QSOs are indexed by what counts for the dupe rule, so dupe
+ * checks take constant time, however long the log is.
+ */
 class Logger {
 public:
 	struct Entry {
@@ -19,12 +50,58 @@ public:
 		std::string rcvdXchg;
 	};
 
-	Logger(const std::string &call, const std::string &cbrFile);
+	Logger(const std::string &call, const std::string &cbrFile, DupeRule dupeRule);
 
 	std::string log(const Entry &e);
-	bool checkIfExists(Ui *ui, const std::string &call, bool exactMatch) const;
+	bool checkIfExists(Ui *ui, const std::string &call, bool exactMatch);
+
+	/* All callsigns in the log, sorted */
+	void getCalls(std::vector<std::string> &calls);
+
+	DupeRule getDupeRule() const;
+
+	/* Frequency in Hz */
+	bool isDupe(const std::string &call, uint32_t freq, Mode mode);
 
 private:
+	struct FileState {
+		bool exists{false};
+		dev_t dev{0};
+		ino_t ino{0};
+		off_t size{0};
+		timespec mtime{0, 0};
+	};
+
 	const std::string call;
 	const std::string cbrFile;
+	const DupeRule dupeRule;
+
+	static const off_t FINGERPRINT_BLOCK = 4096;
+
+	/* State of the file when it was last read */
+	FileState fileState;
+
+	/* Part of the file parsed so far (only complete lines) */
+	off_t parsedSize{0};
+	uint64_t parsedFingerprint{0};
+
+	/* QSO lines, as found in the file */
+	std::vector<std::string> qsos;
+
+	/* Indexes in qsos, by callsign (uppercase) */
+	std::unordered_map<std::string, std::vector<size_t> > callIndex;
+
+	/* Keys of callIndex, sorted. Callsigns are only added to the index, or
+	 * all removed, so it's up to date if it has as many of them.
+	 */
+	std::vector<std::string> sortedCalls;
+
+	/* Dupe keys of all QSOs (see getDupeKey()) */
+	std::unordered_set<std::string> dupeIndex;
+
+	FileState getFileState() const;
+	void refresh();
+	static uint64_t getFingerprint(FILE *fp, off_t size);
+	void addLine(const std::string &line);
+	std::string getDupeKey(const std::string &call, const std::string &freq, const std::string &mode) const;
 };
@@ -1,4 +1,5 @@
 #include <map>
+#include <algorithm>
 #include <vector>
 #include <utility>
 #include "util.h"
@@ -58,109 +59,107 @@ static std::pair<double, std::string> interpolate(uint8_t raw, const std::vector
 	return std::pair<double, std::string>(num, prev->textual);
 }
 
+// Based on FT891_STR_CAL: https://github.com/Hamlib/Hamlib/blob/master/rigs/yaesu/ft891.h#L88
+static const std::vector<CalEntry> SIG_CAL = {
+    {0, -54, "S0"},
+    {12, -48, "S1"},
+    {27, -42, "S2"},
+    {40, -36, "S3"},
+    {55, -30, "S4"},
+    {65, -24, "S5"},
+    {80, -18, "S6"},
+    {95, -12, "S7"},
+    {112, -6, "S8"},
+    {130, 0, "S9"},
+    {150, 10, "S9+10"},
+    {172, 20, "S9+20"},
+    {190, 30, "S9+30"},
+    {220, 40, "S9+40"},
+    {240, 50, "S9+50"},
+    {255, 60, "S9+60"},
+};
+
 static std::string getSig(uint8_t raw)
 {
-	// Based on FT891_STR_CAL: https://github.com/Hamlib/Hamlib/blob/master/rigs/yaesu/ft891.h#L88
-	static const std::vector<CalEntry> cal = {
-	    {0, -54, "S0"},
-	    {12, -48, "S1"},
-	    {27, -42, "S2"},
-	    {40, -36, "S3"},
-	    {55, -30, "S4"},
-	    {65, -24, "S5"},
-	    {80, -18, "S6"},
-	    {95, -12, "S7"},
-	    {112, -6, "S8"},
-	    {130, 0, "S9"},
-	    {150, 10, "S9+10"},
-	    {172, 20, "S9+20"},
-	    {190, 30, "S9+30"},
-	    {220, 40, "S9+40"},
-	    {240, 50, "S9+50"},
-	    {255, 60, "S9+60"},
-	};
-
-	const std::pair<double, std::string> result(interpolate(raw, cal));
+	const std::pair<double, std::string> result(interpolate(raw, SIG_CAL));
 	return util::format("%-5s (%-3.0f dB)", result.second.c_str(), result.first);
 }
 
+static const std::vector<CalEntry> ALC_CAL = {
+    {0, 0, ""},
+    {157, 100, ""},
+    {255, 200, ""},
+};
+
 static std::string getAlc(uint8_t raw)
 {
-	static const std::vector<CalEntry> cal = {
-	    {0, 0, ""},
-	    {157, 100, ""},
-	    {255, 200, ""},
-	};
-
-	return util::format("%3.0f%%", interpolate(raw, cal).first);
+	return util::format("%3.0f%%", interpolate(raw, ALC_CAL).first);
 }
 
+/* Done by counting pixels:
+ *
+ * 0  5  10  15  20  25  30
+ * 0 22  37  49  61  73  87
+ */
+static const std::vector<CalEntry> COMP_CAL = {
+    {0, 0.0, ""},
+    {22 * 255 / 87, 5.0, ""},
+    {37 * 255 / 87, 10.0, ""},
+    {49 * 255 / 87, 15.0, ""},
+    {61 * 255 / 87, 20.0, ""},
+    {73 * 255 / 87, 25.0, ""},
+    {87 * 255 / 87, 30.0, ""},
+};
+
 static std::string getComp(uint8_t raw)
 {
-	/* Done by counting pixels:
-	 *
-	 * 0  5  10  15  20  25  30
-	 * 0 22  37  49  61  73  87
-	 */
-
-	static const std::vector<CalEntry> cal = {
-	    {0, 0.0, ""},
-	    {22 * 255 / 87, 5.0, ""},
-	    {37 * 255 / 87, 10.0, ""},
-	    {49 * 255 / 87, 15.0, ""},
-	    {61 * 255 / 87, 20.0, ""},
-	    {73 * 255 / 87, 25.0, ""},
-	    {87 * 255 / 87, 30.0, ""},
-	};
-
-	return util::format("%4.1f dB", interpolate(raw, cal).first);
+	return util::format("%4.1f dB", interpolate(raw, COMP_CAL).first);
 }
 
+// Based on FT891_RFPOWER_METER_CAL: https://github.com/Hamlib/Hamlib/blob/master/rigs/yaesu/ft891.h#L73
+static const std::vector<CalEntry> PWR_CAL = {
+    {0, 0.0, ""},
+    {10, 0.8, ""},
+    {50, 8.0, ""},
+    {100, 26.0, ""},
+    {150, 54.0, ""},
+    {200, 92.0, ""},
+    {250, 140.0, ""},
+};
+
 static std::string getPwr(uint8_t raw)
 {
-	// Based on FT891_RFPOWER_METER_CAL: https://github.com/Hamlib/Hamlib/blob/master/rigs/yaesu/ft891.h#L73
-	static const std::vector<CalEntry> cal = {
-	    {0, 0.0, ""},
-	    {10, 0.8, ""},
-	    {50, 8.0, ""},
-	    {100, 26.0, ""},
-	    {150, 54.0, ""},
-	    {200, 92.0, ""},
-	    {250, 140.0, ""},
-	};
-
-	return util::format("%5.1f W", interpolate(raw, cal).first);
+	return util::format("%5.1f W", interpolate(raw, PWR_CAL).first);
 }
 
+/* Done by counting pixels:
+ * 1 1.5 2  3  inf
+ * 0 19  37 52 97
+ */
+static const std::vector<CalEntry> SWR_CAL = {
+    {0, 1.0, ""},
+    {19 * 255 / 97, 1.5, ""},
+    {37 * 255 / 97, 2.0, ""},
+    {52 * 255 / 97, 3.0, ""},
+};
+
 static std::string getSwr(uint8_t raw)
 {
-	/* Done by counting pixels:
-	 * 1 1.5 2  3  inf
-	 * 0 19  37 52 97
-	 */
-
-	static const std::vector<CalEntry> cal = {
-	    {0, 1.0, ""},
-	    {19 * 255 / 97, 1.5, ""},
-	    {37 * 255 / 97, 2.0, ""},
-	    {52 * 255 / 97, 3.0, ""},
-	};
-
 	if(raw > 52 * 255 / 97) {
 		return "TOO MUCH";
 	}
 
-	return util::format("%4.2f", interpolate(raw, cal).first);
+	return util::format("%4.2f", interpolate(raw, SWR_CAL).first);
 }
 
+static const std::vector<CalEntry> IDD_CAL = {
+    {0, 0, ""},
+    {255, 30, ""},
+};
+
 static std::string getIdd(uint8_t raw)
 {
-	static const std::vector<CalEntry> cal = {
-	    {0, 0, ""},
-	    {255, 30, ""},
-	};
-
-	return util::format("%4.1f A", interpolate(raw, cal).first);
+	return util::format("%4.1f A", interpolate(raw, IDD_CAL).first);
 }
 
 std::string meters::getValue(Meter m, uint8_t raw)
@@ -178,3 +177,49 @@ std::string meters::getValue(Meter m, uint8_t raw)
 	xassert(i != functions.end(), "Meter %d unknown", m);
 	return i->second(raw);
 }
+
+std::set<meters::Meter> meters::parseSet(const std::string &s)
+{
+	static const Meter all[] = {METER_SIG, METER_ALC, METER_COMP, METER_PWR, METER_SWR, METER_IDD};
+	static const size_t numAll(sizeof(all) / sizeof(all[0]));
+
+	std::set<Meter> rs;
+	if(s.empty()) {
+		rs.insert(all, all + numAll);
+		return rs;
+	}
+
+	const std::vector<std::string> names(util::tokenize(s, ",", 0));
+	for(std::vector<std::string>::const_iterator i(names.begin()); i != names.end(); ++i) {
+		size_t j;
+		for(j = 0; j < numAll; ++j) {
+			if(util::toLower(getName(all[j])) == util::toLower(*i)) {
+				rs.insert(all[j]);
+				break;
+			}
+		}
+
+		xassert(j < numAll, "Unknown meter: %s", i->c_str());
+	}
+
+	return rs;
+}
+
+double meters::getNumeric(Meter m, uint8_t raw)
+{
+	static const std::map<Meter, const std::vector<CalEntry> *> cals = {
+	    {METER_SIG, &SIG_CAL},
+	    {METER_ALC, &ALC_CAL},
+	    {METER_COMP, &COMP_CAL},
+	    {METER_PWR, &PWR_CAL},
+	    {METER_SWR, &SWR_CAL},
+	    {METER_IDD, &IDD_CAL},
+	};
+
+	const std::map<Meter, const std::vector<CalEntry> *>::const_iterator i(cals.find(m));
+	xassert(i != cals.end(), "Meter %d unknown", m);
+
+	/* Readings beyond calibrated range are reported as its end */
+	const std::vector<CalEntry> &cal(*i->second);
+	return interpolate(std::min(raw, cal[cal.size() - 1].raw), cal).first;
+}
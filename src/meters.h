@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <set>
 
 namespace meters {
 
@@ -16,4 +17,14 @@ enum Meter {
 const std::string &getName(Meter m);
 std::string getValue(Meter m, uint8_t raw);
 
+/* Calibrated value: dB relative to S9 (SIG), percent (ALC), dB (COMP),
+ * watts (PWR), ratio (SWR) or amperes (IDD)
+ */
+double getNumeric(Meter m, uint8_t raw);
+
+/* Parses comma-separated list of meter names (case-insensitive); empty
+ * string means all meters
+ */
+std::set<Meter> parseSet(const std::string &s);
+
 } // namespace meters
@@ -0,0 +1,103 @@
+#include "pollscheduler.h"
+
+/* IDD is read in both states to find out if the radio transmits. In TX, the
+ * meters change quickly and there's not much else to read, while in RX only
+ * the signal level changes that often.
+ */
+static const struct {
+	PollScheduler::Query::Type type;
+	meters::Meter meter;
+	uint32_t periodRx;
+	uint32_t periodTx;
+} QUERIES[] = {
+    {PollScheduler::Query::QUERY_METER, meters::METER_IDD, 100, 50},
+    {PollScheduler::Query::QUERY_METER, meters::METER_SIG, 100, 0},
+    {PollScheduler::Query::QUERY_METER, meters::METER_ALC, 0, 50},
+    {PollScheduler::Query::QUERY_METER, meters::METER_COMP, 0, 100},
+    {PollScheduler::Query::QUERY_METER, meters::METER_PWR, 0, 50},
+    {PollScheduler::Query::QUERY_METER, meters::METER_SWR, 0, 50},
+    {PollScheduler::Query::QUERY_FREQ, meters::METER_SIG, 500, 0},
+    {PollScheduler::Query::QUERY_MODE, meters::METER_SIG, 1000, 0},
+};
+
+/* Weight of the last cycle in the cycle time average, as a power of two */
+static const unsigned CYCLE_TIME_SHIFT = 3;
+
+PollScheduler::PollScheduler(const std::set<meters::Meter> &shown, bool pollFreqMode)
+{
+	for(size_t i(0); i < sizeof(QUERIES) / sizeof(QUERIES[0]); ++i) {
+		const auto &q(QUERIES[i]);
+		const bool isMeter(q.type == Query::QUERY_METER);
+		if(!pollFreqMode && !isMeter) {
+			continue;
+		}
+
+		const bool isShown(isMeter && shown.find(q.meter) != shown.end());
+		if(isMeter && !isShown && q.meter != meters::METER_IDD) {
+			continue;
+		}
+
+		Entry entry;
+		entry.query.type  = q.type;
+		entry.query.meter = q.meter;
+		entry.periodRx    = q.periodRx;
+		entry.periodTx    = q.periodTx;
+		entry.nextDue     = 0;
+		entry.shown       = isShown;
+		entries.push_back(entry);
+	}
+}
+
+void PollScheduler::getDue(bool tx, uint64_t now, std::vector<Query> &queries)
+{
+	queries.clear();
+	const uint64_t horizon(now + cycleTime);
+	for(std::vector<Entry>::iterator i(entries.begin()); i != entries.end(); ++i) {
+		const uint32_t period(getPeriod(*i, tx));
+		if(period && i->nextDue <= horizon) {
+			queries.push_back(i->query);
+			i->nextDue = now + period * 1000000ULL;
+		}
+	}
+
+	cycleStart = now;
+}
+
+void PollScheduler::finished(uint64_t now)
+{
+	const uint64_t t(now - cycleStart);
+	if(cycleTime) {
+		cycleTime = cycleTime - (cycleTime >> CYCLE_TIME_SHIFT) + (t >> CYCLE_TIME_SHIFT);
+	}
+	else {
+		cycleTime = t;
+	}
+}
+
+uint64_t PollScheduler::getNextDue(bool tx) const
+{
+	uint64_t next(UINT64_MAX);
+	for(std::vector<Entry>::const_iterator i(entries.begin()); i != entries.end(); ++i) {
+		if(getPeriod(*i, tx) && i->nextDue < next) {
+			next = i->nextDue;
+		}
+	}
+
+	return next;
+}
+
+bool PollScheduler::isMeterShown(meters::Meter meter, bool tx) const
+{
+	for(std::vector<Entry>::const_iterator i(entries.begin()); i != entries.end(); ++i) {
+		if(i->query.type == Query::QUERY_METER && i->query.meter == meter) {
+			return i->shown && getPeriod(*i, tx) != 0;
+		}
+	}
+
+	return false;
+}
+
+uint32_t PollScheduler::getPeriod(const Entry &entry, bool tx)
+{
+	return tx ? entry.periodTx : entry.periodRx;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <set>
+#include <cstdint>
+#include "meters.h"
+
+/* Decides what's read from the radio in every poll cycle. Each query has its
+ * own period in RX and in TX (0 = not read in that state), so fast-changing
+ * meters are read often and slow-changing frequency and mode only now and
+ * then. A new cycle is started as soon as the previous one is finished and
+ * anything is due, so the poll rate is limited by the round-trip time rather
+ * than by a fixed interval.
+ *
+ * Queries due within one measured cycle time from now are sent with the ones
+ * that are due already: they'd be late by about that much anyway, and this way
+ * they don't cost another round trip.
+ */
+class PollScheduler {
+public:
+	struct Query {
+		enum Type {
+			QUERY_METER,
+			QUERY_FREQ,
+			QUERY_MODE,
+		};
+
+		Type type;
+		meters::Meter meter; /* Only for QUERY_METER */
+	};
+
+	/* Only meters in the shown set are polled, except IDD, which is always
+	 * polled to find out if the radio transmits. Frequency and mode aren't
+	 * polled if the radio reports them by itself.
+	 */
+	PollScheduler(const std::set<meters::Meter> &shown, bool pollFreqMode);
+
+	/* Queries due at now, which are scheduled for the next period */
+	void getDue(bool tx, uint64_t now, std::vector<Query> &queries);
+
+	/* Cycle started by getDue() is finished */
+	void finished(uint64_t now);
+
+	/* Earliest time any query is due in given state */
+	uint64_t getNextDue(bool tx) const;
+
+	/* Meter is polled in given state and should be shown */
+	bool isMeterShown(meters::Meter meter, bool tx) const;
+
+private:
+	struct Entry {
+		Query query;
+		uint32_t periodRx; /* ms */
+		uint32_t periodTx; /* ms */
+		uint64_t nextDue;
+		bool shown;
+	};
+
+	std::vector<Entry> entries;
+	uint64_t cycleStart{0};
+	uint64_t cycleTime{0}; /* Moving average, ns */
+
+	static uint32_t getPeriod(const Entry &entry, bool tx);
+};
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include "radio.h"
+#include "throw.h"
+#include "util.h"
+
+Radio::Radio(const Config &config, Reactor *reactor, Ui *ui, Broadcaster *bcast)
+    : number(config.number), tagged(config.tagged), reactor(reactor), ui(ui), bcast(bcast), catReplayer(config.catReplayer)
+{
+	if(!config.catRecording.empty()) {
+		xassert(!config.catPort.empty(), "CAT recording requires CAT port");
+		catRecorder.reset(new CatRecorder(config.catRecording, config.catBaud));
+	}
+
+	if(!config.catPort.empty()) {
+		catTimeoutTimer.reset(new Timer());
+		reactor->add(catTimeoutTimer->getFd(), [this]() {
+			if(catTimeoutTimer->read()) {
+				cat->timeoutTimerExpired(catEvts);
+				catEvtsReady();
+			}
+		});
+
+		catTuneTimer.reset(new Timer());
+		reactor->add(catTuneTimer->getFd(), [this]() {
+			if(catTuneTimer->read()) {
+				cat->tuneTimerExpired();
+			}
+		});
+
+		cat.reset(new Cat(config.catPort, config.catBaud, catTimeoutTimer.get(), catTuneTimer.get(), &catStats, catRecorder.get(), config.catUpdates));
+		pollScheduler.reset(new PollScheduler(config.meters, config.catUpdates == CAT_UPDATES_POLL));
+		reactor->add(cat->getFd(), [this]() {
+			/* Only parsing is timed, drawing would swamp it */
+			const uint64_t start(catReplayer ? util::monotonicNs() : 0);
+			cat->read(catEvts);
+			if(catReplayer) {
+				catReplayer->processed(util::monotonicNs() - start);
+			}
+
+			catEvtsReady();
+		}, [this]() { cat->writeReady(); });
+
+		/* When playing back, responses come without polling */
+		if(!catReplayer) {
+			catMeterTimer.reset(new Timer());
+			reactor->add(catMeterTimer->getFd(), [this]() {
+				if(catMeterTimer->read()) {
+					catStats.pollLateness(util::monotonicNs() - pollDeadline);
+					startPoll();
+				}
+			});
+			schedulePoll();
+		}
+	}
+
+	if(!config.pttPort.empty()) {
+		if(config.rtKeying) {
+			keyerThread.reset(new KeyerThread(std::unique_ptr<Ptt>(new Ptt(config.pttPort)), config.wpm, &keyerStats));
+			ui->print("%sKeyer thread started (%s, %s)",
+			    tagged ? util::format("%s: ", getName().c_str()).c_str() : "",
+			    keyerThread->isRealtime() ? "SCHED_FIFO" : "SCHED_FIFO not permitted",
+			    keyerThread->isMemoryLocked() ? "memory locked" : "memory not locked");
+		}
+		else {
+			ptt.reset(new Ptt(config.pttPort));
+		}
+
+		keyer.reset(new Keyer(config.wpm, keyerThread.get()));
+		reactor->add(keyer->getFd(), [this]() { keyerEvt(keyer->read()); });
+	}
+}
+
+std::string Radio::getName() const
+{
+	return util::format("Radio %u", number);
+}
+
+Cat *Radio::getCat()
+{
+	return cat.get();
+}
+
+Keyer *Radio::getKeyer()
+{
+	return keyer.get();
+}
+
+const std::optional<uint32_t> &Radio::getFreq() const
+{
+	return curFreq;
+}
+
+const std::optional<Mode> &Radio::getMode() const
+{
+	return curMode;
+}
+
+bool Radio::isTransmitting() const
+{
+	return tx || (keyer && keyer->isSending());
+}
+
+std::optional<uint8_t> Radio::getMeter(meters::Meter meter) const
+{
+	const std::map<meters::Meter, uint8_t>::const_iterator i(shownMeters.find(meter));
+	if(i == shownMeters.end()) {
+		return std::nullopt;
+	}
+
+	return i->second;
+}
+
+void Radio::setFreq(uint32_t freq)
+{
+	xassert(cat, "Tuning without CAT");
+	cat->setFreq(freq);
+	curFreq = freq;
+	redraw();
+}
+
+void Radio::setMode(Mode mode)
+{
+	xassert(cat, "Setting mode without CAT");
+	cat->setMode(mode);
+	curMode = mode;
+	redraw();
+}
+
+void Radio::setFocus(bool focus)
+{
+	focused = focus;
+	redraw();
+}
+
+void Radio::prepareWait()
+{
+	if(cat) {
+		reactor->setWriteInterest(cat->getFd(), cat->isWritePending());
+	}
+}
+
+const CatStats &Radio::getCatStats() const
+{
+	return catStats;
+}
+
+const KeyerStats &Radio::getKeyerStats() const
+{
+	return keyerStats;
+}
+
+std::vector<std::string> Radio::getReport() const
+{
+	std::vector<std::string> rs;
+	if(tagged) {
+		rs.push_back(util::format("%s:", getName().c_str()));
+	}
+
+	const std::vector<std::string> keyerReport(keyerStats.getReport());
+	rs.insert(rs.end(), keyerReport.begin(), keyerReport.end());
+	const std::vector<std::string> catReport(catStats.getReport());
+	rs.insert(rs.end(), catReport.begin(), catReport.end());
+	return rs;
+}
+
+void Radio::catEvtsReady()
+{
+	for(std::vector<CatEvt>::const_iterator i(catEvts.begin()); i != catEvts.end(); ++i) {
+		catEvt(*i);
+	}
+
+	/* Lost responses are retried in the background, next cycles don't wait
+	 * for them
+	 */
+	if(polling && cat->isFirstTryDone()) {
+		finishPoll();
+	}
+	else if(catReplayer && !schedMeters.empty()) {
+		showMeters();
+	}
+}
+
+void Radio::catEvt(const CatEvt &evt)
+{
+	switch(evt.type) {
+		case CatEvt::EVT_ERROR:
+			xassert(evt.error, "Expected error field not found");
+			if(tagged) {
+				ui->print("%s: CAT error: %s", getName().c_str(), evt.error.value().c_str());
+			}
+			else {
+				ui->print("CAT error: %s", evt.error.value().c_str());
+			}
+			break;
+
+		case CatEvt::EVT_METER:
+			xassert(evt.meter, "Expected meter field not found");
+
+			if(evt.meter.value().first == meters::METER_IDD) {
+				/* IDD = 0 means RX, anything else means TX */
+				tx = evt.meter.value().second != 0;
+			}
+
+			schedMeters[evt.meter.value().first] = evt.meter.value().second;
+			break;
+
+		case CatEvt::EVT_FREQ:
+			xassert(evt.freq, "Expecting frequency in event");
+			curFreq = evt.freq;
+			broadcastFreq();
+			if(cat->getUpdates() != CAT_UPDATES_POLL) {
+				redraw();
+			}
+			break;
+
+		case CatEvt::EVT_MODE:
+			xassert(evt.mode, "Expecting mode in event");
+			curMode = evt.mode;
+			broadcastMode();
+			if(cat->getUpdates() != CAT_UPDATES_POLL) {
+				redraw();
+			}
+			break;
+
+		default:
+			xthrow("Unknown CAT event %d", evt.type);
+			break;
+	}
+}
+
+void Radio::keyerEvt(const KeyerEvt &evt)
+{
+	xassert(ptt || evt.type == KeyerEvt::EVT_NONE, "Keyer event without PTT, this shouldn't happen");
+
+	switch(evt.type) {
+		case KeyerEvt::EVT_NONE:
+			break;
+
+		case KeyerEvt::EVT_KEY_DOWN:
+			ptt->keyDown();
+			keyerStats.edge(evt.wpm, evt.timeline, evt.deadline, util::monotonicNs());
+			break;
+
+		case KeyerEvt::EVT_KEY_UP:
+			ptt->keyUp();
+			keyerStats.edge(evt.wpm, evt.timeline, evt.deadline, util::monotonicNs());
+			break;
+
+		default:
+			xthrow("Unknown keyer event %d", evt.type);
+			break;
+	}
+}
+
+void Radio::startPoll()
+{
+	/* Whole poll cycle is sent at once, so it costs one round trip. What's
+	 * read depends on the TX state found in the previous cycle, and on what's
+	 * due according to the scheduler.
+	 */
+	pollScheduler->getDue(tx, util::monotonicNs(), pollQueries);
+	if(pollQueries.empty()) {
+		schedulePoll();
+		return;
+	}
+
+	cat->beginBatch();
+	for(std::vector<PollScheduler::Query>::const_iterator i(pollQueries.begin()); i != pollQueries.end(); ++i) {
+		switch(i->type) {
+			case PollScheduler::Query::QUERY_METER:
+				cat->getMeter(i->meter);
+				break;
+
+			case PollScheduler::Query::QUERY_FREQ:
+				cat->getFreq();
+				break;
+
+			case PollScheduler::Query::QUERY_MODE:
+				cat->getMode();
+				break;
+
+			default:
+				xthrow("Unknown poll query %d", i->type);
+				break;
+		}
+	}
+	cat->endBatch();
+
+	polling = true;
+}
+
+void Radio::finishPoll()
+{
+	pollScheduler->finished(util::monotonicNs());
+	showMeters();
+	polling = false;
+	schedulePoll();
+}
+
+void Radio::schedulePoll()
+{
+	/* If something is overdue already, the timer expires right away */
+	pollDeadline = std::max(pollScheduler->getNextDue(tx), util::monotonicNs());
+	catMeterTimer->startAt(pollDeadline);
+}
+
+void Radio::showMeters()
+{
+	/* Meters are read at different rates, so the ones not read in this
+	 * cycle keep their last values. Meters not read in the current TX state,
+	 * or not selected with -m, are dropped; IDD is shown only in TX.
+	 */
+	for(std::map<meters::Meter, uint8_t>::const_iterator i(schedMeters.begin()); i != schedMeters.end(); ++i) {
+		shownMeters[i->first] = i->second;
+	}
+	schedMeters.clear();
+
+	for(std::map<meters::Meter, uint8_t>::iterator i(shownMeters.begin()); i != shownMeters.end();) {
+		if((i->first == meters::METER_IDD && !tx) || !pollScheduler->isMeterShown(i->first, tx)) {
+			i = shownMeters.erase(i);
+		}
+		else {
+			++i;
+		}
+	}
+
+	redraw();
+}
+
+void Radio::redraw()
+{
+	if(focused) {
+		ui->updateMeters(shownMeters, curFreq, curMode, tagged ? util::format("R%u", number) : std::string());
+	}
+}
+
+void Radio::broadcastFreq()
+{
+	xassert(curFreq, "Expecting frequency at this point");
+
+	if(!bcast) {
+		return;
+	}
+
+	BroadcastPacket p("freq_rsp");
+	p.add("freq", util::format("%u", curFreq.value()));
+	bcast->sendPacket(p);
+}
+
+void Radio::broadcastMode()
+{
+	xassert(curMode, "Expecting mode at this point");
+
+	if(!bcast) {
+		return;
+	}
+
+	BroadcastPacket p("mode_rsp");
+	p.add("mode", getModeName(curMode.value()));
+	bcast->sendPacket(p);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <optional>
+#include <cstdint>
+#include "ui.h"
+#include "reactor.h"
+#include "cat.h"
+#include "catstats.h"
+#include "catrecorder.h"
+#include "catreplayer.h"
+#include "pollscheduler.h"
+#include "timer.h"
+#include "ptt.h"
+#include "keyer.h"
+#include "keyerthread.h"
+#include "keyerstats.h"
+#include "broadcaster.h"
+#include "meters.h"
+#include "mode.h"
+
+/* One radio: CAT link with its poll schedule, and PTT port with its keyer.
+ * Every radio has its own timers and non-blocking CAT port, all watched by
+ * the shared reactor, so a slow CAT link of one radio doesn't hold up the
+ * others. Status bar shows the radio that has focus.
+ */
+class Radio {
+public:
+	struct Config {
+		unsigned number{1};         /* For messages and status bar */
+		bool tagged{false};         /* Messages and status bar say which radio it is */
+		std::string catPort;        /* Empty if no CAT */
+		unsigned catBaud{0};
+		CatUpdates catUpdates{CAT_UPDATES_POLL};
+		std::set<meters::Meter> meters;
+		std::string catRecording;   /* Empty if not recording */
+		CatReplayer *catReplayer{nullptr};
+		std::string pttPort;        /* Empty if no PTT */
+		unsigned wpm{0};
+		bool rtKeying{false};
+	};
+
+	/* bcast may be null */
+	Radio(const Config &config, Reactor *reactor, Ui *ui, Broadcaster *bcast);
+
+	std::string getName() const;
+
+	/* Null if disabled */
+	Cat *getCat();
+	Keyer *getKeyer();
+
+	const std::optional<uint32_t> &getFreq() const;
+	const std::optional<Mode> &getMode() const;
+
+	/* Radio transmits according to the last IDD reading, or its keyer is
+	 * sending
+	 */
+	bool isTransmitting() const;
+
+	/* Last reading of a meter, if it's shown in the current TX state */
+	std::optional<uint8_t> getMeter(meters::Meter meter) const;
+
+	/* Shown at once, even if the command is held back by CAT */
+	void setFreq(uint32_t freq);
+	void setMode(Mode mode);
+
+	void setFocus(bool focus);
+
+	/* Called before waiting for events, as anything might have queued CAT
+	 * commands
+	 */
+	void prepareWait();
+
+	const CatStats &getCatStats() const;
+	const KeyerStats &getKeyerStats() const;
+	std::vector<std::string> getReport() const;
+
+private:
+	const unsigned number;
+	const bool tagged;
+	Reactor *reactor;
+	Ui *ui;
+	Broadcaster *bcast;
+	CatReplayer *catReplayer;
+
+	CatStats catStats;
+	std::unique_ptr<CatRecorder> catRecorder;
+	std::unique_ptr<Cat> cat;
+	std::unique_ptr<Timer> catTimeoutTimer;
+	std::unique_ptr<Timer> catMeterTimer;
+	std::unique_ptr<Timer> catTuneTimer;
+	std::unique_ptr<PollScheduler> pollScheduler;
+	std::unique_ptr<Ptt> ptt;
+	KeyerStats keyerStats;
+	std::unique_ptr<KeyerThread> keyerThread;
+	std::unique_ptr<Keyer> keyer;
+
+	std::optional<uint32_t> curFreq; /* Current frequency, updated by CAT */
+	std::optional<Mode> curMode;     /* Current mode, updated by CAT */
+	bool focused{false};             /* Shown on the status bar */
+	bool tx{false};                  /* Radio transmitting, according to the last IDD reading */
+	bool polling{false};             /* Poll cycle in progress */
+	uint64_t pollDeadline{0};        /* When the next poll cycle is scheduled */
+
+	/* Reused for every CAT read */
+	std::vector<CatEvt> catEvts;
+
+	/* Reused for every poll cycle */
+	std::vector<PollScheduler::Query> pollQueries;
+
+	/* Meters being read, scheduled for sending to UI */
+	std::map<meters::Meter, uint8_t> schedMeters;
+
+	/* Meters last sent to UI, kept between poll cycles */
+	std::map<meters::Meter, uint8_t> shownMeters;
+
+	void catEvtsReady();
+	void catEvt(const CatEvt &evt);
+	void keyerEvt(const KeyerEvt &evt);
+	void startPoll();
+	void finishPoll();
+	void schedulePoll();
+	void showMeters();
+	void redraw();
+	void broadcastFreq();
+	void broadcastMode();
+};
@@ -0,0 +1,96 @@
+#include <cerrno>
+#include "reactor.h"
+#include "throw.h"
+#include "util.h"
+
+static int64_t nowMs()
+{
+	return util::monotonicNs() / 1000000;
+}
+
+Reactor::Reactor()
+    : epfd(epoll_create1(EPOLL_CLOEXEC))
+{
+	xassert(epfd != -1, "Could not create epoll instance: %m");
+}
+
+void Reactor::add(int fd, const Callback &cb, const Callback &writeCb)
+{
+	xassert(handlers.find(fd) == handlers.end(), "fd %d already watched", fd);
+
+	std::unique_ptr<Handler> h(new Handler{fd, cb, writeCb, false, false});
+
+	epoll_event ev{};
+	ev.events   = EPOLLIN;
+	ev.data.ptr = h.get();
+	xassert(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0, "Could not add fd %d to epoll: %m", fd);
+
+	handlers[fd] = std::move(h);
+}
+
+void Reactor::remove(int fd)
+{
+	const std::map<int, std::unique_ptr<Handler> >::iterator i(handlers.find(fd));
+	xassert(i != handlers.end(), "fd %d not watched", fd);
+	xassert(epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr) == 0, "Could not remove fd %d from epoll: %m", fd);
+
+	i->second->removed = true;
+	removedHandlers.push_back(std::move(i->second));
+	handlers.erase(i);
+}
+
+void Reactor::setWriteInterest(int fd, bool enable)
+{
+	const std::map<int, std::unique_ptr<Handler> >::iterator i(handlers.find(fd));
+	xassert(i != handlers.end(), "fd %d not watched", fd);
+
+	Handler *h(i->second.get());
+	xassert(h->writeCb, "fd %d has no write callback", fd);
+	if(h->writeInterest == enable) {
+		return;
+	}
+
+	epoll_event ev{};
+	ev.events   = enable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+	ev.data.ptr = h;
+	xassert(epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == 0, "Could not modify fd %d in epoll: %m", fd);
+	h->writeInterest = enable;
+}
+
+bool Reactor::wait(int timeout)
+{
+	const int64_t deadline((timeout >= 0) ? nowMs() + timeout : 0);
+
+	int rs;
+	for(;;) {
+		int remaining(-1);
+		if(timeout >= 0) {
+			const int64_t left(deadline - nowMs());
+			remaining = (left > 0) ? left : 0;
+		}
+
+		rs = epoll_wait(epfd, events, sizeof(events) / sizeof(events[0]), remaining);
+		if(rs == -1 && errno == EINTR) {
+			continue;
+		}
+
+		break;
+	}
+
+	xassert(rs >= 0, "epoll_wait(): %m");
+
+	for(int i(0); i < rs; ++i) {
+		/* Errors and hangups go to the read callback, it'll find out */
+		Handler *h(static_cast<Handler *>(events[i].data.ptr));
+		if(!h->removed && (events[i].events & ~EPOLLOUT)) {
+			h->cb();
+		}
+
+		if(!h->removed && (events[i].events & EPOLLOUT)) {
+			h->writeCb();
+		}
+	}
+
+	removedHandlers.clear();
+	return rs != 0;
+}
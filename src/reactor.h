@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include <sys/epoll.h>
+#include "fd.h"
+
+/* epoll-based event loop. Every watched fd has its own callback, called
+ * directly when the fd becomes readable, so dispatching doesn't require
+ * any lookups or allocations. Optionally, fd can have a second callback,
+ * called when it becomes writable, while write interest is enabled.
+ */
+class Reactor {
+public:
+	typedef std::function<void()> Callback;
+
+	Reactor();
+
+	void add(int fd, const Callback &cb, const Callback &writeCb = Callback());
+	void remove(int fd);
+
+	/* Does nothing if interest is already in the requested state */
+	void setWriteInterest(int fd, bool enable);
+
+	/* Waits for events and dispatches them. Timeout is in milliseconds,
+	 * -1 means infinity. Returns false if timed out.
+	 */
+	bool wait(int timeout);
+
+private:
+	struct Handler {
+		int fd;
+		Callback cb;
+		Callback writeCb;
+		bool writeInterest;
+		bool removed;
+	};
+
+	Fd epfd;
+	std::map<int, std::unique_ptr<Handler> > handlers;
+
+	/* Handlers removed while dispatching; freed when dispatching is done,
+	 * because events pending in the same batch might still point to them
+	 */
+	std::vector<std::unique_ptr<Handler> > removedHandlers;
+
+	epoll_event events[16];
+};
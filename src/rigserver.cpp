@@ -0,0 +1,431 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include "rigserver.h"
+#include "band.h"
+#include "util.h"
+#include "throw.h"
+
+/* Status codes of hamlib */
+static const int RIG_OK      = 0;
+static const int RIG_EINVAL  = -1;
+static const int RIG_ENIMPL  = -4;
+static const int RIG_ENAVAIL = -11;
+
+/* Limits of what's buffered per client; clients exceeding them are dropped */
+static const size_t MAX_LINE   = 1024;
+static const size_t MAX_OUTPUT = 65536;
+
+/* Full power of FT-891, for RFPOWER_METER, which is relative */
+static const double MAX_POWER = 100;
+
+/* Hamlib names of modes */
+static const struct {
+	Mode mode;
+	const char *name;
+} MODES[] = {
+    {MODE_SSB_1, "LSB"},
+    {MODE_SSB_2, "USB"},
+    {MODE_CW_1, "CW"},
+    {MODE_CW_2, "CWR"},
+    {MODE_FM, "FM"},
+    {MODE_AM, "AM"},
+    {MODE_RTTY_1, "RTTY"},
+    {MODE_RTTY_2, "RTTYR"},
+    {MODE_DATA_1, "PKTLSB"},
+    {MODE_DATA_2, "PKTUSB"},
+    {MODE_FM_N, "FMN"},
+    {MODE_AM_N, "AMN"},
+};
+
+/* Long command names, translated to short ones */
+static const std::map<std::string, std::string> LONG_COMMANDS = {
+    {"\\get_freq", "f"},
+    {"\\set_freq", "F"},
+    {"\\get_mode", "m"},
+    {"\\set_mode", "M"},
+    {"\\get_vfo", "v"},
+    {"\\set_vfo", "V"},
+    {"\\get_ptt", "t"},
+    {"\\set_ptt", "T"},
+    {"\\get_level", "l"},
+    {"\\get_info", "_"},
+    {"\\quit", "q"},
+};
+
+static const char *getHamlibMode(Mode mode)
+{
+	for(size_t i(0); i < sizeof(MODES) / sizeof(MODES[0]); ++i) {
+		if(MODES[i].mode == mode) {
+			return MODES[i].name;
+		}
+	}
+
+	xthrow("No hamlib name for mode %d", mode);
+	/* NOTREACHED */
+	return nullptr;
+}
+
+RigServer::RigServer(const std::string &port, Reactor *reactor, Radio *radio, TxLock txLock)
+    : reactor(reactor), radio(radio), txLock(txLock)
+{
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo *ai;
+	const int gaierr = getaddrinfo("127.0.0.1", port.c_str(), &hints, &ai);
+	xassert(!gaierr, "getaddrinfo() error: %s", gai_strerror(gaierr));
+
+	listenFd.reset(socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol));
+	if(listenFd < 0) {
+		freeaddrinfo(ai);
+		xthrow("Could not create rigctld socket: %m");
+	}
+
+	const int one(1);
+	setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	const int rs(bind(listenFd, ai->ai_addr, ai->ai_addrlen));
+	freeaddrinfo(ai);
+	xassert(rs == 0, "Could not bind rigctld socket to port %s: %m", port.c_str());
+	xassert(listen(listenFd, 8) == 0, "listen() failed: %m");
+
+	reactor->add(listenFd, [this]() { accept(); });
+}
+
+RigServer::~RigServer()
+{
+	while(!clients.empty()) {
+		drop(clients.begin()->second.get());
+	}
+
+	reactor->remove(listenFd);
+}
+
+void RigServer::accept()
+{
+	const int fd(accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC));
+	if(fd < 0) {
+		/* Client might have gone already */
+		return;
+	}
+
+	Client *client(new Client());
+	client->fd.reset(fd);
+	clients[fd].reset(client);
+	reactor->add(fd, [this, client]() { read(client); }, [this, client]() { write(client); });
+}
+
+void RigServer::read(Client *client)
+{
+	char buf[1024];
+	const ssize_t rs(recv(client->fd, buf, sizeof(buf), 0));
+	if(rs < 0 && (errno == EAGAIN || errno == EINTR)) {
+		return;
+	}
+
+	if(rs <= 0) {
+		drop(client);
+		return;
+	}
+
+	client->in.append(buf, rs);
+
+	size_t pos;
+	while((pos = client->in.find('\n')) != std::string::npos) {
+		std::string line(client->in, 0, pos);
+		client->in.erase(0, pos + 1);
+		if(!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+
+		std::vector<std::string> args;
+		const std::vector<std::string> tokens(util::tokenize(line, " \t", 0));
+		for(std::vector<std::string>::const_iterator i(tokens.begin()); i != tokens.end(); ++i) {
+			if(!i->empty()) {
+				args.push_back(*i);
+			}
+		}
+
+		if(args.empty()) {
+			continue;
+		}
+
+		if(!execute(client, args)) {
+			drop(client);
+			return;
+		}
+	}
+
+	if(client->in.size() > MAX_LINE || client->out.size() > MAX_OUTPUT) {
+		drop(client);
+		return;
+	}
+
+	write(client);
+}
+
+void RigServer::write(Client *client)
+{
+	if(!client->out.empty()) {
+		const ssize_t rs(send(client->fd, client->out.data(), client->out.size(), MSG_NOSIGNAL));
+		if(rs < 0 && errno != EAGAIN && errno != EINTR) {
+			drop(client);
+			return;
+		}
+
+		if(rs > 0) {
+			client->out.erase(0, rs);
+		}
+	}
+
+	reactor->setWriteInterest(client->fd, !client->out.empty());
+}
+
+void RigServer::drop(Client *client)
+{
+	/* Radio shouldn't be left transmitting by a client that went away */
+	if(client->ptt) {
+		setPtt(client, false);
+	}
+
+	reactor->remove(client->fd);
+	clients.erase(client->fd);
+}
+
+bool RigServer::execute(Client *client, const std::vector<std::string> &args)
+{
+	std::string cmd(args[0]);
+	const std::map<std::string, std::string>::const_iterator longCmd(LONG_COMMANDS.find(cmd));
+	if(longCmd != LONG_COMMANDS.end()) {
+		cmd = longCmd->second;
+	}
+
+	if(cmd == "q" || cmd == "Q") {
+		return false;
+	}
+
+	if(cmd == "\\dump_state") {
+		dumpState(client);
+	}
+	else if(cmd == "\\chk_vfo") {
+		reply(client, "0\n");
+	}
+	else if(cmd == "\\get_powerstat") {
+		reply(client, "1\n");
+	}
+	else if(cmd == "_") {
+		reply(client, "FT-891 via CurseRadio\n");
+	}
+	else if(!radio->getCat()) {
+		replyStatus(client, RIG_ENAVAIL);
+	}
+	else if(cmd == "f") {
+		if(radio->getFreq()) {
+			reply(client, "%u\n", radio->getFreq().value());
+		}
+		else {
+			replyStatus(client, RIG_ENAVAIL);
+		}
+	}
+	else if(cmd == "F") {
+		/* Anything the radio can tune to; FA takes 9 digits anyway */
+		const double freq(args.size() == 2 ? atof(args[1].c_str()) : 0);
+		if(freq < band::getMinByBand(BAND_GEN) || freq > band::getMaxByBand(BAND_GEN)) {
+			replyStatus(client, RIG_EINVAL);
+		}
+		else {
+			radio->setFreq(lround(freq));
+			replyStatus(client, RIG_OK);
+		}
+	}
+	else if(cmd == "m") {
+		/* Passband isn't known, 0 means the default one */
+		if(radio->getMode()) {
+			reply(client, "%s\n0\n", getHamlibMode(radio->getMode().value()));
+		}
+		else {
+			replyStatus(client, RIG_ENAVAIL);
+		}
+	}
+	else if(cmd == "M") {
+		/* Passband is ignored */
+		size_t i(0);
+		while(i < sizeof(MODES) / sizeof(MODES[0]) && (args.size() < 2 || args[1] != MODES[i].name)) {
+			++i;
+		}
+
+		if(i == sizeof(MODES) / sizeof(MODES[0])) {
+			replyStatus(client, RIG_EINVAL);
+		}
+		else {
+			radio->setMode(MODES[i].mode);
+			replyStatus(client, RIG_OK);
+		}
+	}
+	else if(cmd == "v") {
+		reply(client, "VFOA\n");
+	}
+	else if(cmd == "V") {
+		/* VFO B can't be selected, only swapped with A */
+		if(args.size() == 2 && (args[1] == "VFOA" || args[1] == "currVFO" || args[1] == "Main")) {
+			replyStatus(client, RIG_OK);
+		}
+		else {
+			replyStatus(client, RIG_EINVAL);
+		}
+	}
+	else if(cmd == "t") {
+		reply(client, "%d\n", radio->isTransmitting() ? 1 : 0);
+	}
+	else if(cmd == "T") {
+		const bool ptt(args.size() == 2 && atoi(args[1].c_str()) != 0);
+		if(args.size() != 2) {
+			replyStatus(client, RIG_EINVAL);
+		}
+		else if(ptt && !txLock()) {
+			/* Another radio transmits */
+			replyStatus(client, RIG_ENAVAIL);
+		}
+		else {
+			setPtt(client, ptt);
+			replyStatus(client, RIG_OK);
+		}
+	}
+	else if(cmd == "l") {
+		if(args.size() != 2) {
+			replyStatus(client, RIG_EINVAL);
+		}
+		else {
+			getLevel(client, args[1]);
+		}
+	}
+	else {
+		replyStatus(client, RIG_ENIMPL);
+	}
+
+	return true;
+}
+
+void RigServer::reply(Client *client, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	char *p;
+	const int rs(vasprintf(&p, fmt, ap));
+	va_end(ap);
+
+	xassert(rs >= 0, "vasprintf() failed");
+	client->out.append(p, rs);
+	free(p);
+}
+
+void RigServer::replyStatus(Client *client, int status)
+{
+	reply(client, "RPRT %d\n", status);
+}
+
+void RigServer::getLevel(Client *client, const std::string &level)
+{
+	/* Meters not read in current TX state (or not read at all) are zero */
+	static const struct {
+		const char *name;
+		meters::Meter meter;
+	} LEVELS[] = {
+	    {"STRENGTH", meters::METER_SIG},
+	    {"RAWSTR", meters::METER_SIG},
+	    {"ALC", meters::METER_ALC},
+	    {"COMP_METER", meters::METER_COMP},
+	    {"RFPOWER_METER", meters::METER_PWR},
+	    {"RFPOWER_METER_WATTS", meters::METER_PWR},
+	    {"SWR", meters::METER_SWR},
+	    {"ID_METER", meters::METER_IDD},
+	};
+
+	size_t i(0);
+	while(i < sizeof(LEVELS) / sizeof(LEVELS[0]) && level != LEVELS[i].name) {
+		++i;
+	}
+
+	if(i == sizeof(LEVELS) / sizeof(LEVELS[0])) {
+		replyStatus(client, RIG_EINVAL);
+		return;
+	}
+
+	const std::optional<uint8_t> raw(radio->getMeter(LEVELS[i].meter));
+	if(level == "RAWSTR") {
+		reply(client, "%u\n", raw ? raw.value() : 0);
+		return;
+	}
+
+	const double value(raw ? meters::getNumeric(LEVELS[i].meter, raw.value()) : 0);
+	if(level == "STRENGTH") {
+		reply(client, "%ld\n", raw ? lround(value) : -54);
+	}
+	else if(level == "ALC") {
+		reply(client, "%f\n", value / 100);
+	}
+	else if(level == "RFPOWER_METER") {
+		reply(client, "%f\n", value / MAX_POWER);
+	}
+	else if(level == "SWR") {
+		reply(client, "%f\n", raw ? value : 1);
+	}
+	else {
+		reply(client, "%f\n", value);
+	}
+}
+
+void RigServer::dumpState(Client *client)
+{
+	/* Just enough for hamlib's NET rigctl backend: protocol version, rig
+	 * model (FT-891), ITU region, RX and TX ranges, tuning steps, filters,
+	 * RIT/XIT/IF shift limits, announces, preamps, attenuators, functions,
+	 * levels (STRENGTH, RAWSTR, ALC, SWR and the TX meters) and parameters,
+	 * followed by key=value pairs
+	 */
+	reply(client,
+	    "1\n"
+	    "1036\n"
+	    "1\n"
+	    "30000 56000000 0xdbf -1 -1 0x3 0x1\n"
+	    "0 0 0 0 0 0 0\n"
+	    "1800000 54000000 0xdbf 5000 100000 0x3 0x1\n"
+	    "0 0 0 0 0 0 0\n"
+	    "0xdbf 10\n"
+	    "0 0\n"
+	    "0 0\n"
+	    "0\n"
+	    "0\n"
+	    "0\n"
+	    "0\n"
+	    "\n"
+	    "\n"
+	    "0x0\n"
+	    "0x0\n"
+	    "0x8b74000000\n"
+	    "0x0\n"
+	    "0x0\n"
+	    "0x0\n"
+	    "vfo_ops=0x0\n"
+	    "ptt_type=0x1\n"
+	    "targetable_vfo=0x0\n"
+	    "has_set_vfo=0x0\n"
+	    "has_get_vfo=0x1\n"
+	    "done\n");
+}
+
+void RigServer::setPtt(Client *client, bool ptt)
+{
+	radio->getCat()->setTx(ptt);
+	client->ptt = ptt;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include "reactor.h"
+#include "radio.h"
+#include "fd.h"
+
+/* TCP server speaking the rigctld protocol (as used by hamlib's NET rigctl
+ * backend, model 2), so other programs can share the radio with us. It only
+ * listens on localhost.
+ *
+ * Reads are answered from the state Radio keeps up to date anyway, without
+ * a round trip to the radio, so clients don't add any load to the CAT link,
+ * however many of them there are and however often they ask. Frequency and
+ * mode changes go through the same coalescing queue as tuning from the
+ * keyboard.
+ */
+class RigServer {
+public:
+	/* Returns false if the radio may not transmit now, as another one does */
+	typedef std::function<bool()> TxLock;
+
+	RigServer(const std::string &port, Reactor *reactor, Radio *radio, TxLock txLock);
+	~RigServer();
+
+private:
+	struct Client {
+		Fd fd;
+		std::string in;
+		std::string out;
+		bool ptt{false}; /* Client keyed the radio */
+	};
+
+	Reactor *reactor;
+	Radio *radio;
+	TxLock txLock;
+	Fd listenFd;
+	std::map<int, std::unique_ptr<Client> > clients;
+
+	void accept();
+	void read(Client *client);
+	void write(Client *client);
+	void drop(Client *client);
+
+	/* Returns false if client should be dropped */
+	bool execute(Client *client, const std::vector<std::string> &args);
+
+	void reply(Client *client, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+	void replyStatus(Client *client, int status);
+
+	void getLevel(Client *client, const std::string &level);
+	void dumpState(Client *client);
+	void setPtt(Client *client, bool ptt);
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/* Fixed-size, lock-free ring buffer for a single producer and a single
+ * consumer (they may be different threads). Positions are free-running
+ * counters, so N doesn't have to be a power of two, but it's faster if
+ * it is.
+ */
+template <typename T, size_t N>
+class RingBuffer {
+public:
+	/* Producer side. Either all items are pushed and published at once,
+	 * or nothing is pushed if there's not enough space
+	 */
+	bool push(const T *items, size_t count)
+	{
+		const size_t t(tail.load(std::memory_order_relaxed));
+		if(N - (t - head.load(std::memory_order_acquire)) < count) {
+			return false;
+		}
+
+		for(size_t i(0); i < count; ++i) {
+			buf[(t + i) % N] = items[i];
+		}
+
+		tail.store(t + count, std::memory_order_release);
+		return true;
+	}
+
+	bool push(const T &item)
+	{
+		return push(&item, 1);
+	}
+
+	/* Consumer side */
+	bool pop(T &item)
+	{
+		const size_t h(head.load(std::memory_order_relaxed));
+		if(h == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		item = buf[h % N];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* Consumer side; item is valid until the next pop() or discard() */
+	const T *front() const
+	{
+		const size_t h(head.load(std::memory_order_relaxed));
+		if(h == tail.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+
+		return &buf[h % N];
+	}
+
+	/* Consumer side; discards everything pushed before producer position
+	 * pos (as returned by getTail())
+	 */
+	void discard(size_t pos)
+	{
+		const size_t h(head.load(std::memory_order_relaxed));
+		if(pos - h <= N) {
+			head.store(pos, std::memory_order_release);
+		}
+	}
+
+	size_t getTail() const
+	{
+		return tail.load(std::memory_order_acquire);
+	}
+
+	size_t size() const
+	{
+		/* Head first, so it can't overtake the tail snapshot */
+		const size_t h(head.load(std::memory_order_acquire));
+		return tail.load(std::memory_order_acquire) - h;
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+private:
+	T buf[N];
+	std::atomic<size_t> head{0};
+	std::atomic<size_t> tail{0};
+};
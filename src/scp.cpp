@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cctype>
+#include "scp.h"
+#include "file.h"
+#include "util.h"
+#include "throw.h"
+
+Scp::Scp(const std::string &path)
+{
+	const uint64_t start(util::monotonicNs());
+
+	std::string data;
+	{
+		const File fp(fopen(path.c_str(), "r"));
+		xassert(fp, "Could not open known callsigns file %s: %m", path.c_str());
+
+		char buf[65536];
+		size_t len;
+		while((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+			data.append(buf, len);
+		}
+
+		xassert(!ferror(fp), "Error reading known callsigns file %s: %m", path.c_str());
+	}
+
+	/* Callsigns are uppercased in place and sorted as views into the file
+	 * contents, so nothing is allocated per callsign
+	 */
+	std::vector<std::string_view> sorted;
+	size_t pos(0);
+	while(pos < data.size()) {
+		size_t end(data.find('\n', pos));
+		if(end == std::string::npos) {
+			end = data.size();
+		}
+
+		size_t b(pos);
+		size_t e(end);
+		pos = end + 1;
+
+		while(b < e && isspace((unsigned char) data[b])) {
+			++b;
+		}
+
+		while(e > b && isspace((unsigned char) data[e - 1])) {
+			--e;
+		}
+
+		if(b == e || data[b] == '#') {
+			continue;
+		}
+
+		bool valid(true);
+		for(size_t i(b); i < e && valid; ++i) {
+			data[i] = toupper((unsigned char) data[i]);
+			valid = getCharCode(data[i]) >= 0;
+		}
+
+		if(!valid) {
+			++skipped;
+			continue;
+		}
+
+		sorted.push_back(std::string_view(data.data() + b, e - b));
+	}
+
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+	calls.reserve(data.size());
+	callStart.reserve(sorted.size() + 1);
+	for(std::vector<std::string_view>::const_iterator i(sorted.begin()); i != sorted.end(); ++i) {
+		callStart.push_back(calls.size());
+		calls.append(i->data(), i->size());
+	}
+	callStart.push_back(calls.size());
+	calls.shrink_to_fit();
+
+	index();
+	loadTime = util::monotonicNs() - start;
+}
+
+size_t Scp::getSize() const
+{
+	return callStart.size() - 1;
+}
+
+size_t Scp::getSkipped() const
+{
+	return skipped;
+}
+
+uint64_t Scp::getLoadTime() const
+{
+	return loadTime;
+}
+
+void Scp::find(const std::string &part, std::vector<uint32_t> &found) const
+{
+	found.clear();
+
+	if(part.empty()) {
+		for(uint32_t i(0); i < getSize(); ++i) {
+			found.push_back(i);
+		}
+		return;
+	}
+
+	uint32_t begin;
+	uint32_t end;
+	if(!getList(part, begin, end)) {
+		return;
+	}
+
+	for(uint32_t i(begin); i < end; ++i) {
+		if(part.size() <= MAX_GRAM || getCall(postings[i]).find(part) != std::string_view::npos) {
+			found.push_back(postings[i]);
+		}
+	}
+}
+
+void Scp::narrow(const std::string &part, std::vector<uint32_t> &found) const
+{
+	if(part.empty()) {
+		return;
+	}
+
+	uint32_t begin;
+	uint32_t end;
+	if(!getList(part, begin, end)) {
+		found.clear();
+		return;
+	}
+
+	/* Both ways check every callsign once, so the shorter list wins */
+	if(end - begin < found.size()) {
+		find(part, found);
+		return;
+	}
+
+	std::vector<uint32_t>::iterator out(found.begin());
+	for(std::vector<uint32_t>::const_iterator i(found.begin()); i != found.end(); ++i) {
+		if(getCall(*i).find(part) != std::string_view::npos) {
+			*out++ = *i;
+		}
+	}
+	found.erase(out, found.end());
+}
+
+bool Scp::contains(std::string_view call) const
+{
+	/* Callsigns are sorted */
+	uint32_t lo(0);
+	uint32_t hi(getSize());
+	while(lo < hi) {
+		const uint32_t mid(lo + (hi - lo) / 2);
+		if(getCall(mid) < call) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+
+	return lo < getSize() && getCall(lo) == call;
+}
+
+std::string_view Scp::getCall(uint32_t index) const
+{
+	return std::string_view(calls.data() + callStart[index], callStart[index + 1] - callStart[index]);
+}
+
+int Scp::getCharCode(char ch)
+{
+	if(ch >= 'A' && ch <= 'Z') {
+		return ch - 'A';
+	}
+
+	if(ch >= '0' && ch <= '9') {
+		return ch - '0' + 26;
+	}
+
+	if(ch == '/') {
+		return 36;
+	}
+
+	return -1;
+}
+
+bool Scp::getGram(const char *s, size_t len, unsigned &gram)
+{
+	/* Shorter n-grams come first */
+	unsigned offset(0);
+	unsigned count(1);
+	gram = 0;
+	for(size_t i(0); i < len; ++i) {
+		const int code(getCharCode(s[i]));
+		if(code < 0) {
+			return false;
+		}
+
+		offset += count;
+		count *= ALPHABET;
+		gram = gram * ALPHABET + code;
+	}
+
+	gram += offset - 1;
+	return true;
+}
+
+bool Scp::getList(const std::string &part, uint32_t &begin, uint32_t &end) const
+{
+	const size_t len(part.size() < MAX_GRAM ? part.size() : MAX_GRAM);
+	unsigned best(0);
+	for(size_t i(0); i + len <= part.size(); ++i) {
+		unsigned gram;
+		if(!getGram(part.data() + i, len, gram)) {
+			/* No callsign has this character */
+			return false;
+		}
+
+		if(i == 0 || gramStart[gram + 1] - gramStart[gram] < gramStart[best + 1] - gramStart[best]) {
+			best = gram;
+		}
+	}
+
+	begin = gramStart[best];
+	end   = gramStart[best + 1];
+	return true;
+}
+
+void Scp::index()
+{
+	xassert(calls.size() <= UINT32_MAX, "Too many known callsigns");
+
+	/* Two passes: first counts callsigns per n-gram, so the lists can be
+	 * laid out one after another, second fills them. Callsigns go in
+	 * order, so lists are sorted, and an n-gram found twice in a callsign
+	 * is recognized by the last callsign added to its list.
+	 */
+	const auto forEachGram = [](std::string_view call, auto fn) {
+		/* Same numbering as getGram(), built up one character at a time;
+		 * characters were checked when loading
+		 */
+		for(size_t i(0); i < call.size(); ++i) {
+			unsigned offset(0);
+			unsigned count(1);
+			unsigned gram(0);
+			for(size_t len(1); len <= MAX_GRAM && i + len <= call.size(); ++len) {
+				offset += count;
+				count *= ALPHABET;
+				gram = gram * ALPHABET + getCharCode(call[i + len - 1]);
+				fn(offset - 1 + gram);
+			}
+		}
+	};
+
+	gramStart.assign(GRAMS + 1, 0);
+	std::vector<uint32_t> last(GRAMS, UINT32_MAX);
+	for(uint32_t i(0); i < getSize(); ++i) {
+		forEachGram(getCall(i), [this, &last, i](unsigned gram) {
+			if(last[gram] != i) {
+				last[gram] = i;
+				++gramStart[gram + 1];
+			}
+		});
+	}
+
+	for(unsigned i(0); i < GRAMS; ++i) {
+		gramStart[i + 1] += gramStart[i];
+	}
+
+	postings.resize(gramStart[GRAMS]);
+	std::vector<uint32_t> next(gramStart.begin(), gramStart.end() - 1);
+	last.assign(GRAMS, UINT32_MAX);
+	for(uint32_t i(0); i < getSize(); ++i) {
+		forEachGram(getCall(i), [this, &last, &next, i](unsigned gram) {
+			if(last[gram] != i) {
+				last[gram] = i;
+				postings[next[gram]++] = i;
+			}
+		});
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+/* Known callsigns (Super Check Partial), loaded from a MASTER.SCP-style
+ * file: one callsign per line, lines starting with # are comments.
+ *
+ * Callsigns are sorted and packed one after another in a single buffer.
+ * For every n-gram (one, two or three consecutive characters), there's a
+ * list of callsigns containing it, also packed in a single buffer. Partials
+ * up to three characters long are n-grams, so their list is the answer.
+ * Longer partials are looked up by taking the shortest list of their
+ * trigrams and checking only the callsigns on it, so only a few hundred
+ * of them are ever looked at, even with tens of thousands loaded.
+ */
+class Scp {
+public:
+	Scp(const std::string &path);
+
+	size_t getSize() const;
+
+	/* Lines that didn't look like a callsign */
+	size_t getSkipped() const;
+
+	/* How long loading and indexing took, in ns */
+	uint64_t getLoadTime() const;
+
+	/* Callsigns containing part (uppercase), as indexes in alphabetical order.
+	 * Empty part matches everything.
+	 */
+	void find(const std::string &part, std::vector<uint32_t> &found) const;
+
+	/* Same as find(), but found already holds callsigns containing a
+	 * substring of part (like the result for part without its last
+	 * character), so they can be checked again instead of being looked up,
+	 * if that's cheaper
+	 */
+	void narrow(const std::string &part, std::vector<uint32_t> &found) const;
+
+	bool contains(std::string_view call) const;
+
+	std::string_view getCall(uint32_t index) const;
+
+private:
+	/* A-Z, 0-9 and /; n-grams of every length are numbered one after
+	 * another, shortest first
+	 */
+	static const unsigned ALPHABET = 37;
+	static const size_t MAX_GRAM   = 3;
+	static const unsigned GRAMS    = ALPHABET + ALPHABET * ALPHABET + ALPHABET * ALPHABET * ALPHABET;
+
+	size_t skipped{0};
+	uint64_t loadTime{0};
+
+	/* All callsigns, without separators; callsign i starts at callStart[i]
+	 * and ends where the next one starts
+	 */
+	std::string calls;
+	std::vector<uint32_t> callStart;
+
+	/* Indexes of callsigns containing n-gram g are at
+	 * postings[gramStart[g]] to postings[gramStart[g + 1]]
+	 */
+	std::vector<uint32_t> gramStart;
+	std::vector<uint32_t> postings;
+
+	/* -1 if the character can't be in a callsign */
+	static int getCharCode(char ch);
+
+	/* Number of n-gram of length len; returns false if it's not valid */
+	static bool getGram(const char *s, size_t len, unsigned &gram);
+
+	/* Shortest list of callsigns that might contain part (non-empty); it's
+	 * exactly the callsigns containing part if part is an n-gram. Returns
+	 * false if no callsign contains part.
+	 */
+	bool getList(const std::string &part, uint32_t &begin, uint32_t &end) const;
+
+	void index();
+};
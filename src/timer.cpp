@@ -1,124 +1,65 @@
-#include <inttypes.h>
-#include <sys/select.h>
+#include <cerrno>
 #include <unistd.h>
+#include <sys/timerfd.h>
 #include "timer.h"
 #include "throw.h"
-
-/* Timer protocol:
- * - (re)start timer: write '1'
- * - stop timer: write '0'
- * - if timer elapsed, reads 'x'
- * - EOF: terminate thread
- *
- * Note that interval = 0 must be supported as well due to how keyer is implemented.
+#include "util.h"
+
+/* Notes:
+ * - timer is one-shot; after expiration it has to be started again
+ * - deadlines are absolute nanoseconds of CLOCK_MONOTONIC (see util::monotonicNs())
+ * - interval = 0 must be supported as well due to how keyer is implemented;
+ *   it's done by arming the timer with an absolute deadline equal to the
+ *   current time, which expires immediately (relative zero would disarm it)
+ * - (re)arming or stopping the timer discards unread expirations, so read()
+ *   returns false if the timer was stopped after the fd became readable
  */
 
-static void threadFunc(SocketPair *sp, std::atomic<uint32_t> *interval)
-{
-	useconds_t usecNeeded(0);
-	bool timerEnabled(false);
-
-	for(;;) {
-		fd_set rfd;
-		FD_ZERO(&rfd);
-		FD_SET(sp->get1(), &rfd);
-
-		timeval tv;
-		tv.tv_sec  = 0;
-		tv.tv_usec = usecNeeded;
-		const int rs(select(sp->get1() + 1, &rfd, nullptr, nullptr, timerEnabled ? &tv : nullptr));
-
-		if(rs == 0) {
-			/* Timed out */
-			if(!timerEnabled) {
-				/* Error, timed out but timeout not expected now */
-				break;
-			}
-
-			/* Signal timeout and stop timer */
-			const uint8_t ch('x');
-			if(write(sp->get1(), &ch, 1) != 1) {
-				break;
-			}
-
-			timerEnabled = false;
-		}
-		else if(rs == 1) {
-			/* Activity on socket */
-			uint8_t ch;
-			const ssize_t rrs(read(sp->get1(), &ch, 1));
-			if(rrs != 1) {
-				/* Error or EOF, in any case, break */
-				break;
-			}
-
-			if(ch == '0') {
-				/* Stop timer if it's active */
-				timerEnabled = false;
-			}
-			else if(ch == '1') {
-				/* Start or restart timer */
-				usecNeeded   = *interval * 1000;
-				timerEnabled = true;
-			}
-			else {
-				/* Invalid char received, break */
-				break;
-			}
-		}
-		else {
-			/* Something else returned by select, unsupported */
-			break;
-		}
-	}
-
-	sp->close1();
-}
-
 Timer::Timer(uint32_t interval_)
-    : interval(interval_),
-      thread(std::thread(threadFunc, &sp, &interval))
-{
-}
-
-Timer::~Timer()
+    : fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      interval(interval_)
 {
-	sp.close0();
-	thread.join();
+	xassert(fd != -1, "Could not create timerfd: %m");
 }
 
 int Timer::getFd() const
 {
-	return sp.get0();
+	return fd;
 }
 
 bool Timer::read()
 {
-	uint8_t ch;
-	const ssize_t rs(::read(sp.get0(), &ch, 1));
-	xassert(rs == 1, "Could not read from socket: %zd, %m", rs);
-	xassert(ch == 'x', "Invalid character read from socket: 0x%02x", ch);
-	return true;
+	uint64_t expirations;
+	const ssize_t rs(::read(fd, &expirations, sizeof(expirations)));
+	if(rs == -1 && (errno == EAGAIN || errno == EINTR)) {
+		return false;
+	}
+
+	xassert(rs == sizeof(expirations), "Could not read from timerfd: %zd, %m", rs);
+	return expirations != 0;
 }
 
 void Timer::start()
 {
-	sendCommand('1');
+	startAt(util::monotonicNs() + interval * 1000000ULL);
 }
 
 void Timer::start(uint32_t interval_)
 {
 	interval = interval_;
-	sendCommand('1');
+	start();
 }
 
-void Timer::stop()
+void Timer::startAt(uint64_t deadline)
 {
-	sendCommand('0');
+	itimerspec its{};
+	its.it_value.tv_sec  = deadline / 1000000000ULL;
+	its.it_value.tv_nsec = deadline % 1000000000ULL;
+	xassert(timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, nullptr) == 0, "Could not start timer: %m");
 }
 
-void Timer::sendCommand(uint8_t cmd)
+void Timer::stop()
 {
-	const ssize_t rs(write(sp.get0(), &cmd, 1));
-	xassert(rs == 1, "Could not write to socket: %zd, %m", rs);
+	const itimerspec its{};
+	xassert(timerfd_settime(fd, 0, &its, nullptr) == 0, "Could not stop timer: %m");
 }
@@ -1,26 +1,25 @@
 #pragma once
 
-#include <thread>
 #include <cinttypes>
-#include <atomic>
-#include "socketpair.h"
+#include "fd.h"
 
+/* One-shot timer backed by timerfd. Deadlines are absolute (CLOCK_MONOTONIC),
+ * so the timer fd can be watched directly by the main loop, without helper
+ * threads.
+ */
 class Timer {
 public:
 	Timer(uint32_t interval_ = 0);
-	~Timer();
 
 	int getFd() const;
 	bool read();
 
 	void start();
 	void start(uint32_t interval_);
+	void startAt(uint64_t deadline);
 	void stop();
 
 private:
-	SocketPair sp;
-	std::atomic<uint32_t> interval;
-	std::thread thread;
-
-	void sendCommand(uint8_t cmd);
+	Fd fd;
+	uint32_t interval;
 };
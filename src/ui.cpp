@@ -14,6 +14,7 @@ static const short PAIR_TEXT          = 1;
 static const short PAIR_PROMPT        = 2;
 static const short PAIR_PROMPTED_TEXT = 3;
 static const short PAIR_STATUS        = 4;
+static const short PAIR_WORKED        = 5;
 
 Ui::Ui()
 {
@@ -31,6 +32,7 @@ Ui::Ui()
 	xassert(init_pair(PAIR_PROMPT, COLOR_GREEN, COLOR_BLACK) != ERR, "init_pair() failed");
 	xassert(init_pair(PAIR_PROMPTED_TEXT, COLOR_WHITE, COLOR_BLACK) != ERR, "init_pair() failed");
 	xassert(init_pair(PAIR_STATUS, COLOR_WHITE, COLOR_BLUE) != ERR, "init_pair() call failed");
+	xassert(init_pair(PAIR_WORKED, COLOR_RED, COLOR_BLACK) != ERR, "init_pair() call failed");
 	xassert(wbkgd(metersWin, COLOR_PAIR(PAIR_STATUS)) != ERR, "wbkgd() call failed");
 	wattron(mainWin, COLOR_PAIR(PAIR_TEXT));
 	wattroff(mainWin, A_BOLD);
@@ -86,12 +88,8 @@ void Ui::printNoNL(const char *fmt, ...)
 	maybeRefresh();
 }
 
-void Ui::updateMeters(const std::map<meters::Meter, uint8_t> &meters, const std::optional<uint32_t> &freq, const std::optional<Mode> &mode)
+void Ui::updateMeters(const std::map<meters::Meter, uint8_t> &meters, const std::optional<uint32_t> &freq, const std::optional<Mode> &mode, const std::string &tag)
 {
-	if(meters.empty()) {
-		return;
-	}
-
 	struct Meter {
 		std::string name;
 		uint8_t raw;
@@ -102,6 +100,10 @@ void Ui::updateMeters(const std::map<meters::Meter, uint8_t> &meters, const std:
 	std::string prefix(util::format("%c ", busyChars[busyCharIndex++]));
 	busyCharIndex %= busyChars.size();
 
+	if(!tag.empty()) {
+		prefix += tag + " ";
+	}
+
 	if(freq && mode) {
 		prefix += util::format("%s %s | ", util::formatFreq(freq.value()).c_str(), getModeName(mode.value()).c_str());
 	}
@@ -119,7 +121,9 @@ void Ui::updateMeters(const std::map<meters::Meter, uint8_t> &meters, const std:
 		totalLength += m.name.size() + m.text.size() + 4;
 	}
 
-	totalLength += 3 * (meters.size() - 1); /* Meters separator: " | " */
+	if(!meters.empty()) {
+		totalLength += 3 * (meters.size() - 1); /* Meters separator: " | " */
+	}
 
 	const unsigned cols(COLS);
 	xassert(cols > 1, "Screen too narrow");
@@ -127,7 +131,7 @@ void Ui::updateMeters(const std::map<meters::Meter, uint8_t> &meters, const std:
 	const unsigned lineLength(cols - 1);
 	xassert(totalLength <= lineLength, "Total length %u exceeds line length %u, this shouldn't happen", totalLength, lineLength);
 
-	const unsigned bargraphLength((lineLength - totalLength) / meters.size());
+	const unsigned bargraphLength(meters.empty() ? 0 : (lineLength - totalLength) / meters.size());
 
 	std::string metersString(prefix);
 	for(std::vector<Meter>::const_iterator i(translatedMeters.begin()); i != translatedMeters.end(); ++i) {
@@ -154,6 +158,66 @@ void Ui::updateMeters(const std::map<meters::Meter, uint8_t> &meters, const std:
 	xassert(wrefresh(metersWin) != ERR, "wrefresh() call failed");
 }
 
+void Ui::showSuggestions()
+{
+	xassert(!suggestWin, "Suggestions already shown");
+
+	/* If the main window is full, its top line goes, so the rest stays
+	 * where it is on the screen
+	 */
+	WINDOW *const win(mainWin);
+	int y;
+	int x;
+	getyx(win, y, x);
+	if(y == getmaxy(win) - 1) {
+		xassert(wscrl(mainWin, 1) != ERR, "wscrl() call failed");
+		xassert(wmove(mainWin, y - 1, x) != ERR, "wmove() call failed");
+	}
+
+	xassert(wresize(mainWin, LINES - 2, COLS) != ERR, "wresize() call failed");
+	xassert(mvwin(mainWin, 2, 0) != ERR, "mvwin() call failed");
+	xassert((suggestWin = newwin(1, COLS, 1, 0)) != nullptr, "newwin() failed");
+	xassert(leaveok(suggestWin, TRUE) != ERR, "leaveok() call failed");
+
+	xassert(wrefresh(suggestWin) != ERR, "wrefresh() call failed");
+	xassert(touchwin(win) != ERR, "touchwin() call failed");
+	maybeRefresh();
+}
+
+void Ui::updateSuggestions(const std::vector<std::string> &workedCalls, const std::vector<std::string> &knownCalls, size_t total)
+{
+	const unsigned cols(COLS);
+	xassert(cols > 1, "Screen too narrow");
+
+	/* Room is left for the number of callsigns that don't fit */
+	const size_t lineLength(cols - 1);
+	const size_t moreLength(util::format(" +%zu", total).size());
+
+	xassert(werase(suggestWin) != ERR, "werase() call failed");
+
+	size_t length(0);
+	size_t shown(0);
+	for(size_t i(0); i < workedCalls.size() + knownCalls.size(); ++i) {
+		const bool worked(i < workedCalls.size());
+		const std::string &call(worked ? workedCalls[i] : knownCalls[i - workedCalls.size()]);
+		if(length + call.size() + 1 + moreLength > lineLength) {
+			break;
+		}
+
+		wattrset(suggestWin, worked ? (COLOR_PAIR(PAIR_WORKED) | A_BOLD) : COLOR_PAIR(PAIR_TEXT));
+		xassert(wprintw(suggestWin, "%s ", call.c_str()) != ERR, "wprintw() call failed");
+		length += call.size() + 1;
+		++shown;
+	}
+
+	wattrset(suggestWin, COLOR_PAIR(PAIR_TEXT));
+	if(shown < total) {
+		xassert(wprintw(suggestWin, "+%zu", total - shown) != ERR, "wprintw() call failed");
+	}
+
+	xassert(wrefresh(suggestWin) != ERR, "wrefresh() call failed");
+}
+
 UiEvt Ui::read()
 {
 	const int ch(getch());
@@ -250,6 +314,9 @@ UiEvt Ui::readCmd(int ch)
 		case 'v':
 			return UiEvt::EVT_SWAP;
 
+		case 'r':
+			return UiEvt::EVT_NEXT_RADIO;
+
 		case 'p':
 			return UiEvt::EVT_SHOW_PRESETS;
 
@@ -292,6 +359,12 @@ UiEvt Ui::readCmd(int ch)
 		case 'z':
 			return UiEvt::EVT_ZERO_IN;
 
+		case 'j':
+			return UiEvt::EVT_SHOW_KEYER_STATS;
+
+		case 'i':
+			return UiEvt::EVT_SHOW_CAT_STATS;
+
 		default:
 			print("Invalid key pressed; press 'h' for help, 'q' to quit");
 			break;
@@ -389,7 +462,7 @@ UiEvt Ui::readFanMode(int ch)
 UiEvt Ui::readCheckCall(int ch)
 {
 	if(!handleTextInput(ch, true)) {
-		return UiEvt::EVT_NONE;
+		return checkPartialCall();
 	}
 
 	setState(STATE_CMD);
@@ -406,7 +479,7 @@ UiEvt Ui::readCheckCall(int ch)
 UiEvt Ui::readLog(int ch)
 {
 	if(!handleTextInput(ch, true)) {
-		return UiEvt::EVT_NONE;
+		return checkPartialCall();
 	}
 
 	setState(STATE_CMD);
@@ -477,6 +550,7 @@ void Ui::help()
 	    "  v: swap VFO\n"
 	    "  s: select SSB mode (equivalent of ms)\n"
 	    "  c: select CW mode (equivalent of mc)\n"
+	    "  r: switch to the next radio\n"
 	    "\n"
 	    "Presets:\n"
 	    "  p: show presets\n"
@@ -494,6 +568,10 @@ void Ui::help()
 	    "  a: abort sending\n"
 	    "  z: zero-in (ZIN)\n"
 	    "\n"
+	    "Statistics:\n"
+	    "  j: show keyer timing statistics\n"
+	    "  i: show CAT link statistics\n"
+	    "\n"
 	    "=== Keyboard help end ===\n";
 
 	xassert(wprintw(mainWin, "%s", helpstr) != ERR, "wprintw() call failed");
@@ -505,6 +583,13 @@ void Ui::setState(State newState)
 	state = newState;
 	switch(newState) {
 		case STATE_CMD:
+			/* Suggestions are only for the prompt that was just left */
+			if(!partialCall.empty()) {
+				partialCall.clear();
+				if(suggestWin) {
+					updateSuggestions(std::vector<std::string>(), std::vector<std::string>(), 0);
+				}
+			}
 			break;
 
 		case STATE_BAND: {
@@ -644,6 +729,19 @@ bool Ui::handleTextInput(int ch, bool allChars)
 	return false;
 }
 
+UiEvt Ui::checkPartialCall()
+{
+	const std::string call(util::toUpper(pendingText.substr(0, pendingText.find(' '))));
+	if(call == partialCall) {
+		return UiEvt::EVT_NONE;
+	}
+
+	partialCall = call;
+	UiEvt evt(UiEvt::EVT_PARTIAL_CALL);
+	evt.partialCall = call;
+	return evt;
+}
+
 void Ui::printWithAttr(short pair, bool bold, bool dorefresh, const std::string &text)
 {
 	wattron(mainWin, COLOR_PAIR(pair) | (bold ? A_BOLD : 0));
@@ -32,6 +32,7 @@ public:
 		EVT_MODE,            /* m */
 		EVT_SWAP,            /* v */
 		EVT_FAN_MODE,        /* f */
+		EVT_NEXT_RADIO,      /* r */
 
 		/* Presets */
 		EVT_SHOW_PRESETS, /* p */
@@ -42,6 +43,7 @@ public:
 		EVT_CHECK_CALL,  /* c; checkCallData */
 		EVT_LOG,         /* l; logData */
 		EVT_FREEZE_TIME, /* When l is pressed */
+		EVT_PARTIAL_CALL, /* Callsign typed so far in k or l changed; partialCall */
 
 		/* CW */
 		EVT_SEND_TEXT,  /* t; sendTextData */
@@ -49,6 +51,10 @@ public:
 		EVT_WPM_DOWN,   /* d */
 		EVT_SEND_ABORT, /* a */
 		EVT_ZERO_IN,    /* z */
+
+		/* Statistics */
+		EVT_SHOW_KEYER_STATS, /* j */
+		EVT_SHOW_CAT_STATS,   /* i */
 	};
 
 	const EventType type;
@@ -60,6 +66,7 @@ public:
 	const std::optional<std::string> logRst;  /* EVT_LOG (and might not be present) */
 	const std::optional<std::string> logXchg; /* EVT_LOG */
 	std::optional<std::string> checkCall;     /* EVT_CHECK_CALL */
+	std::optional<std::string> partialCall;   /* EVT_PARTIAL_CALL */
 	std::optional<std::string> text;          /* EVT_SEND_TEXT */
 
 	UiEvt(EventType type)
@@ -94,7 +101,14 @@ public:
 	void print(const char *fmt, ...);
 	void printNoNL(const char *fmt, ...);
 	void printPrompt(const std::string &prompt);
-	void updateMeters(const std::map<meters::Meter, uint8_t> &meters, const std::optional<uint32_t> &freq, const std::optional<Mode> &mode);
+	/* Tag tells which radio it is, if there's more than one */
+	void updateMeters(const std::map<meters::Meter, uint8_t> &meters, const std::optional<uint32_t> &freq, const std::optional<Mode> &mode, const std::string &tag);
+	/* Takes the line below the meters from the main window for callsign
+	 * suggestions; without them, it's not reserved
+	 */
+	void showSuggestions();
+	/* Worked callsigns are highlighted; total includes callsigns not given */
+	void updateSuggestions(const std::vector<std::string> &workedCalls, const std::vector<std::string> &knownCalls, size_t total);
 
 private:
 	enum State {
@@ -112,7 +126,9 @@ private:
 	bool blockMode{false};
 	bool pendingRefresh{false};
 	std::string pendingText;
+	std::string partialCall; /* Last one sent with EVT_PARTIAL_CALL */
 	CursesWindow metersWin;
+	CursesWindow suggestWin;
 	CursesWindow mainWin;
 	size_t busyCharIndex{0};
 
@@ -125,6 +141,9 @@ private:
 
 	bool handleTextInput(int ch, bool allChars);
 
+	/* EVT_PARTIAL_CALL if callsign (first word) of pendingText changed */
+	UiEvt checkPartialCall();
+
 	UiEvt readCmd(int ch);
 	UiEvt readBand(int ch);
 	UiEvt readMode(int ch);
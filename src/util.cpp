@@ -2,10 +2,9 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
-#include <cerrno>
 #include <algorithm>
 #include <cctype>
-#include <sys/select.h>
+#include <ctime>
 #include "util.h"
 #include "throw.h"
 
@@ -59,55 +58,14 @@ std::vector<std::string> util::tokenize(const std::string &s, const std::string
 	return rs;
 }
 
-std::set<int> util::watch(const std::set<int> &in, int timeout)
+std::string util::formatFreq(uint32_t freq)
 {
-	// TODO rewrite to use poll(), it's more elegant
-
-	fd_set rfd;
-	FD_ZERO(&rfd);
-
-	int maxfd(-1);
-	for(auto fd : in) {
-		FD_SET(fd, &rfd);
-		if(fd > maxfd) {
-			maxfd = fd;
-		}
-	}
-
-	timeval tv;
-	tv.tv_sec  = (timeout >= 0) ? timeout : 0;
-	tv.tv_usec = 0;
-
-	for(;;) {
-		const int selrs(select(maxfd + 1, &rfd, NULL, NULL, (timeout >= 0) ? &tv : NULL));
-		if(selrs == 0) {
-			return std::set<int>{};
-		}
-
-		if(selrs < 0) {
-			if(errno == EAGAIN || errno == EINTR) {
-				// TODO recalculate timeout
-				continue;
-			}
-
-			xthrow("select(): %m");
-		}
-
-		std::set<int> out;
-		for(auto fd : in) {
-			if(FD_ISSET(fd, &rfd)) {
-				out.insert(fd);
-			}
-		}
-
-		return out;
-	}
-
-	/* NOTREACHED */
-	return std::set<int>{};
+	return format("%u.%03u kHz", freq / 1000, freq % 1000);
 }
 
-std::string util::formatFreq(uint32_t freq)
+uint64_t util::monotonicNs()
 {
-	return format("%u.%03u kHz", freq / 1000, freq % 1000);
+	timespec ts;
+	xassert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0, "clock_gettime() failed: %m");
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }